@@ -0,0 +1,111 @@
+//Copyright 2018 Raphael Haucke
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+//http ://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+
+#include "AliasTable.h"
+#include "Globals.h"
+
+
+
+void FAliasTable::Build(const TArray<double> &weights)
+{
+	const int Count = weights.Num();
+
+	m_Probabilities.SetNumUninitialized(Count, false);
+	m_Aliases.SetNumUninitialized(Count, false);
+	m_Scaled.SetNumUninitialized(Count, false);
+	m_Small.Reset();
+	m_Large.Reset();
+
+	double Total = 0.0;
+	for (double weight : weights)
+	{
+		Total += FMath::Max(weight, 0.0);
+	}
+
+	//nothing to prefer, draw uniformly
+	if (Total <= 0.0)
+	{
+		for (int i = 0; i < Count; ++i)
+		{
+			m_Probabilities[i] = 1.0;
+			m_Aliases[i] = i;
+		}
+		return;
+	}
+
+	//scale so the average column holds exactly 1
+	for (int i = 0; i < Count; ++i)
+	{
+		m_Scaled[i] = FMath::Max(weights[i], 0.0) * Count / Total;
+
+		if (m_Scaled[i] < 1.0)
+		{
+			m_Small.Add(i);
+		}
+		else
+		{
+			m_Large.Add(i);
+		}
+	}
+
+	//fill up every small column with the excess of a large one
+	while (m_Small.Num() > 0 && m_Large.Num() > 0)
+	{
+		int Less = m_Small.Pop(false);
+		int More = m_Large.Pop(false);
+
+		m_Probabilities[Less] = m_Scaled[Less];
+		m_Aliases[Less] = More;
+
+		m_Scaled[More] = (m_Scaled[More] + m_Scaled[Less]) - 1.0;
+
+		if (m_Scaled[More] < 1.0)
+		{
+			m_Small.Add(More);
+		}
+		else
+		{
+			m_Large.Add(More);
+		}
+	}
+
+	//what is left is full up to rounding errors
+	for (int index : m_Large)
+	{
+		m_Probabilities[index] = 1.0;
+		m_Aliases[index] = index;
+	}
+	for (int index : m_Small)
+	{
+		m_Probabilities[index] = 1.0;
+		m_Aliases[index] = index;
+	}
+}
+
+int FAliasTable::Sample(FRandomStream &rng) const
+{
+	int Column = RandInt(rng, 0, m_Probabilities.Num() - 1);
+
+	if (RandFloat(rng) < m_Probabilities[Column])
+	{
+		return Column;
+	}
+	return m_Aliases[Column];
+}
+
+void FAliasTable::Reset()
+{
+	m_Probabilities.Reset();
+	m_Aliases.Reset();
+}
@@ -0,0 +1,43 @@
+//Copyright 2018 Raphael Haucke
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+//http ://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+//Walker/Vose alias table. Draws an index with probability proportional to its weight in constant time, building it
+//is linear in the number of weights. Negative weights count as zero, if all weights are zero every index is equally likely
+class NEATSHOOTER_API FAliasTable
+{
+private:
+	//chance to keep the drawn column, otherwise its alias is taken
+	TArray<double> m_Probabilities;
+	TArray<int> m_Aliases;
+
+	//scaled weights and work lists of the build, kept to reuse their memory
+	TArray<double> m_Scaled;
+	TArray<int> m_Small;
+	TArray<int> m_Large;
+
+public:
+	//Replaces the table with one for the given weights
+	void Build(const TArray<double> &weights);
+
+	//Returns an index in [0, Num()). The table must not be empty
+	int Sample(FRandomStream &rng) const;
+
+	int Num() const { return m_Probabilities.Num(); }
+	void Reset();
+};
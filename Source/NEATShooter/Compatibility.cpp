@@ -0,0 +1,326 @@
+//Copyright 2018 Raphael Haucke
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+//http ://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+
+#include "Compatibility.h"
+#include "Parameters.h"
+#include "Globals.h"
+
+
+
+FSCompatibilityCoefficients::FSCompatibilityCoefficients(const UParameters* parameters)
+{
+	dExcess = parameters->dExcessCoeff;
+	dDisjoint = parameters->dDisjointCoeff;
+	dMatching = parameters->dMatchingCoeff;
+}
+
+double FCompatibility::Distance(const FSPackedLinks &first, const FSPackedLinks &second, const FSCompatibilityCoefficients &coefficients)
+{
+	const int32* IDs1 = first.InnovationIDs.GetData();
+	const int32* IDs2 = second.InnovationIDs.GetData();
+	const double* Weights1 = first.Weights.GetData();
+	const double* Weights2 = second.Weights.GetData();
+	const int Num1 = first.InnovationIDs.Num();
+	const int Num2 = second.InnovationIDs.Num();
+
+	int Pos1 = 0;
+	int Pos2 = 0;
+	int NumMatching = 0;
+	int NumDisjoint = 0;
+	double WeightDifference = 0;
+
+	//the positions advance by flags instead of taking a different branch for every kind of gene
+	while ((Pos1 < Num1) && (Pos2 < Num2))
+	{
+		const int32 ID1 = IDs1[Pos1];
+		const int32 ID2 = IDs2[Pos2];
+		const bool bMatching = (ID1 == ID2);
+		const bool bFirstSmaller = (ID1 < ID2);
+
+		WeightDifference += bMatching ? FMath::Abs(Weights1[Pos1] - Weights2[Pos2]) : 0.0;
+		NumMatching += bMatching;
+		NumDisjoint += !bMatching;
+		Pos1 += (bMatching | bFirstSmaller);
+		Pos2 += !bFirstSmaller;
+	}
+
+	//whatever is left over in one of the genomes is excess
+	int NumExcess = (Num1 - Pos1) + (Num2 - Pos2);
+
+	return Score(NumExcess, NumDisjoint, NumMatching, WeightDifference, FMath::Max(Num1, Num2), coefficients);
+}
+
+FSCompatibilityResult FCompatibility::TestThreshold(const FSPackedLinks &first, const FSPackedLinks &second, const FSCompatibilityCoefficients &coefficients, double threshold)
+{
+	const int32* IDs1 = first.InnovationIDs.GetData();
+	const int32* IDs2 = second.InnovationIDs.GetData();
+	const double* Weights1 = first.Weights.GetData();
+	const double* Weights2 = second.Weights.GetData();
+	const int Num1 = first.InnovationIDs.Num();
+	const int Num2 = second.InnovationIDs.Num();
+	const int NumGenesOfBigGenome = FMath::Max(Num1, Num2);
+
+	//the bound needs every term to grow with its count
+	const bool bCanExitEarly = (coefficients.dExcess >= 0) && (coefficients.dDisjoint >= 0) && (coefficients.dMatching >= 0);
+	const double CheapestUnmatched = FMath::Min(coefficients.dExcess, coefficients.dDisjoint);
+
+	int Pos1 = 0;
+	int Pos2 = 0;
+	int NumMatching = 0;
+	int NumDisjoint = 0;
+	double WeightDifference = 0;
+	int NextBoundCheck = BoundCheckInterval;
+
+	while ((Pos1 < Num1) && (Pos2 < Num2))
+	{
+		const int32 ID1 = IDs1[Pos1];
+		const int32 ID2 = IDs2[Pos2];
+		const bool bMatching = (ID1 == ID2);
+		const bool bFirstSmaller = (ID1 < ID2);
+
+		WeightDifference += bMatching ? FMath::Abs(Weights1[Pos1] - Weights2[Pos2]) : 0.0;
+		NumMatching += bMatching;
+		NumDisjoint += !bMatching;
+		Pos1 += (bMatching | bFirstSmaller);
+		Pos2 += !bFirstSmaller;
+
+		if (bCanExitEarly && (--NextBoundCheck == 0))
+		{
+			NextBoundCheck = BoundCheckInterval;
+
+			//disjoint genes found so far stay disjoint, and at least the difference of the remaining genes can't match
+			int MinUnmatchedLeft = FMath::Abs((Num1 - Pos1) - (Num2 - Pos2));
+			double LowerBound = (coefficients.dDisjoint * NumDisjoint + CheapestUnmatched * MinUnmatchedLeft) / NumGenesOfBigGenome;
+
+			if (LowerBound > threshold + FSCompatibilityResult::BoundSlack)
+			{
+				return FSCompatibilityResult(LowerBound, false);
+			}
+		}
+	}
+
+	int NumExcess = (Num1 - Pos1) + (Num2 - Pos2);
+
+	return FSCompatibilityResult(Score(NumExcess, NumDisjoint, NumMatching, WeightDifference, NumGenesOfBigGenome, coefficients), true, NumExcess + NumDisjoint);
+}
+
+double FCompatibility::Distance(const FSLinkSignature &first, const FSLinkSignature &second, const FSCompatibilityCoefficients &coefficients)
+{
+	int NumExcess, NumDisjoint;
+	CountUnmatched(first, second, NumExcess, NumDisjoint);
+
+	double WeightDifference;
+	int NumMatching = SumMatchingWeights(first, second, WeightDifference);
+
+	return Score(NumExcess, NumDisjoint, NumMatching, WeightDifference, FMath::Max(first.NumGenes, second.NumGenes), coefficients);
+}
+
+FSCompatibilityResult FCompatibility::TestThreshold(const FSLinkSignature &first, const FSLinkSignature &second, const FSCompatibilityCoefficients &coefficients, double threshold)
+{
+	int NumExcess, NumDisjoint;
+	CountUnmatched(first, second, NumExcess, NumDisjoint);
+
+	const int NumGenesOfBigGenome = FMath::Max(first.NumGenes, second.NumGenes);
+
+	//the unmatched genes are counted exactly, if their terms alone are too far away the weights don't need to be looked at.
+	//Adding the non negative weight term can't make the sum smaller, so this is the same comparison the full score does
+	if ((coefficients.dExcess >= 0) && (coefficients.dDisjoint >= 0) && (coefficients.dMatching >= 0))
+	{
+		double NumGenes = NumGenesOfBigGenome;
+		double UnmatchedScore = (coefficients.dExcess * (NumExcess / NumGenes)) + (coefficients.dDisjoint * (NumDisjoint / NumGenes));
+
+		if (UnmatchedScore > threshold)
+		{
+			return FSCompatibilityResult(UnmatchedScore, false, NumExcess + NumDisjoint);
+		}
+	}
+
+	double WeightDifference;
+	int NumMatching = SumMatchingWeights(first, second, WeightDifference);
+
+	return FSCompatibilityResult(Score(NumExcess, NumDisjoint, NumMatching, WeightDifference, NumGenesOfBigGenome, coefficients), true, NumExcess + NumDisjoint);
+}
+
+int FCompatibility::CountUnmatched(const FSPackedLinks &first, const FSPackedLinks &second)
+{
+	const int32* IDs1 = first.InnovationIDs.GetData();
+	const int32* IDs2 = second.InnovationIDs.GetData();
+	const int Num1 = first.InnovationIDs.Num();
+	const int Num2 = second.InnovationIDs.Num();
+
+	int Pos1 = 0;
+	int Pos2 = 0;
+	int NumMatching = 0;
+
+	while ((Pos1 < Num1) && (Pos2 < Num2))
+	{
+		const bool bMatching = (IDs1[Pos1] == IDs2[Pos2]);
+		const bool bFirstSmaller = (IDs1[Pos1] < IDs2[Pos2]);
+
+		NumMatching += bMatching;
+		Pos1 += (bMatching | bFirstSmaller);
+		Pos2 += !bFirstSmaller;
+	}
+
+	return Num1 + Num2 - 2 * NumMatching;
+}
+
+void FCompatibility::CountUnmatched(const FSLinkSignature &first, const FSLinkSignature &second, int &outNumExcess, int &outNumDisjoint)
+{
+	const int NumWords = FMath::Min(first.Words.Num(), second.Words.Num());
+	const uint64* Words1 = first.Words.GetData();
+	const uint64* Words2 = second.Words.GetData();
+
+	int NumUnmatched = 0;
+	for (int i = 0; i < NumWords; ++i)
+	{
+		NumUnmatched += PopCount64(Words1[i] ^ Words2[i]);
+	}
+
+	//the genes of the genome reaching further that lie above the highest gene of the other one are excess
+	outNumExcess = 0;
+	if (first.HighestBit != second.HighestBit)
+	{
+		const FSLinkSignature &Longer = (first.HighestBit > second.HighestBit) ? first : second;
+		const int LastSharedBit = FMath::Min(first.HighestBit, second.HighestBit);
+
+		int NumUpToLastSharedBit = 0;
+		if (LastSharedBit >= 0)
+		{
+			int Word = LastSharedBit / 64;
+			int BitInWord = LastSharedBit % 64;
+			uint64 Mask = (BitInWord == 63) ? ~0ull : ((1ull << (BitInWord + 1)) - 1);
+			NumUpToLastSharedBit = Longer.WordRanks[Word] + PopCount64(Longer.Words[Word] & Mask);
+		}
+		outNumExcess = Longer.NumGenes - NumUpToLastSharedBit;
+	}
+
+	outNumDisjoint = NumUnmatched - outNumExcess;
+}
+
+int FCompatibility::SumMatchingWeights(const FSLinkSignature &first, const FSLinkSignature &second, double &outWeightDifference)
+{
+	const int NumWords = FMath::Min(first.Words.Num(), second.Words.Num());
+
+	int NumMatching = 0;
+	outWeightDifference = 0;
+
+	for (int i = 0; i < NumWords; ++i)
+	{
+		uint64 Matching = first.Words[i] & second.Words[i];
+
+		//lowest bit first, the same order the link lists are in
+		while (Matching != 0)
+		{
+			uint64 BitsBelow = (Matching & (~Matching + 1)) - 1;
+
+			int Weight1 = first.WordRanks[i] + PopCount64(first.Words[i] & BitsBelow);
+			int Weight2 = second.WordRanks[i] + PopCount64(second.Words[i] & BitsBelow);
+			outWeightDifference += FMath::Abs(first.Weights[Weight1] - second.Weights[Weight2]);
+
+			++NumMatching;
+			Matching &= Matching - 1;
+		}
+	}
+	return NumMatching;
+}
+
+void FInnovationBitTable::Build(const TArray<const FSPackedLinks*> &genomes)
+{
+	int MaxID = -1;
+	for (const FSPackedLinks* curGenome : genomes)
+	{
+		for (int32 ID : curGenome->InnovationIDs)
+		{
+			MaxID = FMath::Max(MaxID, (int)ID);
+		}
+	}
+
+	//mark the used innovations with 0
+	m_BitOfInnovation.SetNumUninitialized(MaxID + 1, false);
+	for (int i = 0; i <= MaxID; ++i)
+	{
+		m_BitOfInnovation[i] = -1;
+	}
+
+	for (const FSPackedLinks* curGenome : genomes)
+	{
+		for (int32 ID : curGenome->InnovationIDs)
+		{
+			if (ID >= 0)
+			{
+				m_BitOfInnovation[ID] = 0;
+			}
+		}
+	}
+
+	//and give them their bits in ascending order
+	m_iNumBits = 0;
+	for (int i = 0; i <= MaxID; ++i)
+	{
+		if (m_BitOfInnovation[i] == 0)
+		{
+			m_BitOfInnovation[i] = m_iNumBits;
+			++m_iNumBits;
+		}
+	}
+}
+
+void FInnovationBitTable::CreateSignature(const FSPackedLinks &links, FSLinkSignature &outSignature) const
+{
+	const int NumWords = GetNumWords();
+	const int NumLinks = links.InnovationIDs.Num();
+
+	outSignature.Words.SetNumZeroed(NumWords, false);
+	outSignature.WordRanks.SetNumUninitialized(NumWords, false);
+	outSignature.Weights.SetNumUninitialized(NumLinks, false);
+	outSignature.NumGenes = NumLinks;
+	outSignature.bValid = true;
+
+	int LastBit = -1;
+	for (int i = 0; i < NumLinks; ++i)
+	{
+		int32 ID = links.InnovationIDs[i];
+		int Bit = ((ID >= 0) && (ID < m_BitOfInnovation.Num())) ? m_BitOfInnovation[ID] : -1;
+
+		//links are sorted by innovation, so the bits have to be strictly ascending. Anything else is a duplicate
+		if ((Bit < 0) || (Bit <= LastBit))
+		{
+			outSignature.bValid = false;
+			continue;
+		}
+
+		outSignature.Words[Bit / 64] |= (1ull << (Bit % 64));
+		outSignature.Weights[i] = links.Weights[i];
+		LastBit = Bit;
+	}
+	outSignature.HighestBit = LastBit;
+
+	int Rank = 0;
+	for (int i = 0; i < NumWords; ++i)
+	{
+		outSignature.WordRanks[i] = Rank;
+		Rank += PopCount64(outSignature.Words[i]);
+	}
+}
+
+double FCompatibility::Score(int numExcess, int numDisjoint, int numMatching, double weightDifference, int numGenesOfBigGenome, const FSCompatibilityCoefficients &coefficients)
+{
+	//same order of operations as the original score so the results are bit identical
+	double NumGenes = numGenesOfBigGenome;
+
+	return (coefficients.dExcess * (numExcess / NumGenes)) +
+		(coefficients.dDisjoint * (numDisjoint / NumGenes)) +
+		(coefficients.dMatching * (weightDifference / double(numMatching)));
+}
@@ -0,0 +1,146 @@
+//Copyright 2018 Raphael Haucke
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+//http ://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+class UParameters;
+
+
+//Links of a genome split into innovation IDs and weights, in innovation order. Used by the compatibility kernel
+struct FSPackedLinks
+{
+	TArray<int32> InnovationIDs;
+	TArray<double> Weights;
+
+	//false after the links changed
+	bool bValid;
+
+	FSPackedLinks() : bValid(false) {}
+};
+
+//A genome's links as a set of bits, one bit per innovation of the current population, with the weights of the set bits
+//in bit order. Bits are handed out in innovation order, so comparing two signatures sees the genes in the same order
+//as walking the link lists
+struct FSLinkSignature
+{
+	TArray<uint64> Words;
+	//number of set bits in all words before each word, to find the weight of a bit
+	TArray<int32> WordRanks;
+	TArray<double> Weights;
+
+	int NumGenes;
+	//-1 for a genome without links
+	int HighestBit;
+
+	//false if the genome had an innovation twice or one the table didn't know, a set can't describe it then
+	bool bValid;
+
+	FSLinkSignature() : NumGenes(0), HighestBit(-1), bValid(false) {}
+};
+
+//Maps the innovation IDs used by a set of genomes to consecutive bits, in ascending ID order. Rebuilt every speciation
+class NEATSHOOTER_API FInnovationBitTable
+{
+private:
+	//bit of every innovation ID, -1 if no genome uses it
+	TArray<int32> m_BitOfInnovation;
+	int m_iNumBits;
+
+public:
+	FInnovationBitTable() : m_iNumBits(0) {}
+
+	//Assigns bits to all innovations the genomes use
+	void Build(const TArray<const FSPackedLinks*> &genomes);
+
+	//Writes the signature of a genome whose innovations were part of the build
+	void CreateSignature(const FSPackedLinks &links, FSLinkSignature &outSignature) const;
+
+	int GetNumBits() const { return m_iNumBits; }
+	int GetNumWords() const { return (m_iNumBits + 63) / 64; }
+};
+
+//The coefficients of the compatibility score, read once per speciation instead of once per comparison
+struct FSCompatibilityCoefficients
+{
+	double dExcess;
+	double dDisjoint;
+	double dMatching;
+
+	FSCompatibilityCoefficients() : dExcess(1.0), dDisjoint(1.0), dMatching(0.4) {}
+	explicit FSCompatibilityCoefficients(const UParameters* parameters);
+};
+
+//Outcome of a threshold test: the exact score, or a lower bound that already was over the threshold
+struct FSCompatibilityResult
+{
+	//slack on the lower bounds so rounding can't reject a genome the exact score would accept
+	static constexpr double BoundSlack = 1e-9;
+
+	double dScore;
+	bool bExact;
+
+	//excess + disjoint genes, -1 if the test stopped before knowing
+	int iNumUnmatched;
+
+	FSCompatibilityResult() : dScore(0.0), bExact(false), iNumUnmatched(-1) {}
+	FSCompatibilityResult(double score, bool bIsExact, int numUnmatched = -1) : dScore(score), bExact(bIsExact), iNumUnmatched(numUnmatched) {}
+
+	bool IsWithin(double threshold) const { return bExact && (dScore <= threshold); }
+
+	//true if the result also answers the test for this threshold
+	bool Decides(double threshold) const { return bExact || (dScore > threshold + BoundSlack); }
+};
+
+//Kernels measuring how far apart two genomes are. Both give exactly the same answer as the score NEAT defines:
+//excess * dExcess / N + disjoint * dDisjoint / N + weight difference * dMatching / matching, N being the size of the bigger genome.
+//Without matching genes the score is NaN and never within a threshold
+class NEATSHOOTER_API FCompatibility
+{
+public:
+	//Returns the compatibility score
+	static double Distance(const FSPackedLinks &first, const FSPackedLinks &second, const FSCompatibilityCoefficients &coefficients);
+
+	//Tests the compatibility score against threshold. Gives up with a lower bound as soon as the genes seen so far push the score over it
+	static FSCompatibilityResult TestThreshold(const FSPackedLinks &first, const FSPackedLinks &second, const FSCompatibilityCoefficients &coefficients, double threshold);
+
+	//Same as above on signatures of the same table. Excess and disjoint genes are counted a word at a time,
+	//only the matching genes are visited one by one
+	static double Distance(const FSLinkSignature &first, const FSLinkSignature &second, const FSCompatibilityCoefficients &coefficients);
+	static FSCompatibilityResult TestThreshold(const FSLinkSignature &first, const FSLinkSignature &second, const FSCompatibilityCoefficients &coefficients, double threshold);
+
+	//Returns the number of excess + disjoint genes
+	static int CountUnmatched(const FSPackedLinks &first, const FSPackedLinks &second);
+
+	//Counts the excess and disjoint genes of two signatures
+	static void CountUnmatched(const FSLinkSignature &first, const FSLinkSignature &second, int &outNumExcess, int &outNumDisjoint);
+
+	//Returns true if the compatibility score is <= threshold
+	template<typename TLinks>
+	static bool IsWithinThreshold(const TLinks &first, const TLinks &second, const FSCompatibilityCoefficients &coefficients, double threshold)
+	{
+		return TestThreshold(first, second, coefficients, threshold).IsWithin(threshold);
+	}
+
+private:
+	//number of merge steps between two checks of the lower bound
+	static const int BoundCheckInterval = 16;
+
+	//Sums up the weight differences of the matching genes in innovation order, returns the number of matching genes
+	static int SumMatchingWeights(const FSLinkSignature &first, const FSLinkSignature &second, double &outWeightDifference);
+
+	static double Score(int numExcess, int numDisjoint, int numMatching, double weightDifference, int numGenesOfBigGenome, const FSCompatibilityCoefficients &coefficients);
+};
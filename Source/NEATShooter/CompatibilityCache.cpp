@@ -0,0 +1,159 @@
+//Copyright 2018 Raphael Haucke
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+//http ://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+
+#include "CompatibilityCache.h"
+
+
+
+FCompatibilityCache::FCompatibilityCache()
+{
+	m_iHead = -1;
+	m_iTail = -1;
+	m_iCapacity = 0;
+	m_iNumLookups = 0;
+	m_iNumHits = 0;
+}
+
+void FCompatibilityCache::Prepare(int capacity, const FSCompatibilityCoefficients &coefficients)
+{
+	bool bCoefficientsChanged = (coefficients.dExcess != m_Coefficients.dExcess) || (coefficients.dDisjoint != m_Coefficients.dDisjoint) ||
+		(coefficients.dMatching != m_Coefficients.dMatching);
+
+	if (bCoefficientsChanged || (capacity != m_iCapacity))
+	{
+		Clear();
+		m_iCapacity = FMath::Max(capacity, 0);
+		m_Coefficients = coefficients;
+		m_Entries.Reserve(m_iCapacity);
+		m_Lookup.Reserve(m_iCapacity);
+	}
+}
+
+void FCompatibilityCache::Clear()
+{
+	m_Entries.Reset();
+	m_Lookup.Reset();
+	m_iHead = -1;
+	m_iTail = -1;
+}
+
+int FCompatibilityCache::Find(uint64 hash1, uint64 hash2) const
+{
+	const int* Entry = m_Lookup.Find(FSPairKey(hash1, hash2));
+	return Entry ? *Entry : -1;
+}
+
+void FCompatibilityCache::Touch(int entry)
+{
+	if (entry == m_iHead)
+	{
+		return;
+	}
+	Unlink(entry);
+	LinkFront(entry);
+}
+
+void FCompatibilityCache::Add(uint64 hash1, uint64 hash2, const FSCompatibilityResult &result)
+{
+	if (m_iCapacity <= 0)
+	{
+		return;
+	}
+
+	FSPairKey Key(hash1, hash2);
+
+	//a lower bound for an older threshold gets replaced by the new result
+	if (int* Existing = m_Lookup.Find(Key))
+	{
+		m_Entries[*Existing].Result = result;
+		Touch(*Existing);
+		return;
+	}
+
+	int NewEntry;
+	if (m_Entries.Num() < m_iCapacity)
+	{
+		NewEntry = m_Entries.AddUninitialized();
+	}
+	else
+	{
+		//reuse the least recently used entry
+		NewEntry = m_iTail;
+		Unlink(NewEntry);
+		m_Lookup.Remove(m_Entries[NewEntry].Key);
+	}
+
+	m_Entries[NewEntry].Key = Key;
+	m_Entries[NewEntry].Result = result;
+	LinkFront(NewEntry);
+	m_Lookup.Add(Key, NewEntry);
+}
+
+void FCompatibilityCache::RecordLookups(int numLookups, int numHits)
+{
+	m_iNumLookups += numLookups;
+	m_iNumHits += numHits;
+}
+
+double FCompatibilityCache::ConsumeHitRate()
+{
+	double HitRate = (m_iNumLookups > 0) ? double(m_iNumHits) / m_iNumLookups : 0.0;
+
+	m_iNumLookups = 0;
+	m_iNumHits = 0;
+
+	return HitRate;
+}
+
+void FCompatibilityCache::Unlink(int entry)
+{
+	FSEntry &Entry = m_Entries[entry];
+
+	if (Entry.Prev >= 0)
+	{
+		m_Entries[Entry.Prev].Next = Entry.Next;
+	}
+	else
+	{
+		m_iHead = Entry.Next;
+	}
+
+	if (Entry.Next >= 0)
+	{
+		m_Entries[Entry.Next].Prev = Entry.Prev;
+	}
+	else
+	{
+		m_iTail = Entry.Prev;
+	}
+}
+
+void FCompatibilityCache::LinkFront(int entry)
+{
+	FSEntry &Entry = m_Entries[entry];
+
+	Entry.Prev = -1;
+	Entry.Next = m_iHead;
+
+	if (m_iHead >= 0)
+	{
+		m_Entries[m_iHead].Prev = entry;
+	}
+	m_iHead = entry;
+
+	if (m_iTail < 0)
+	{
+		m_iTail = entry;
+	}
+}
@@ -0,0 +1,94 @@
+//Copyright 2018 Raphael Haucke
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+//http ://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+
+#pragma once
+
+#include "Compatibility.h"
+
+#include "CoreMinimal.h"
+
+
+//Remembers the results of compatibility tests between genome contents across generations. Entries are keyed on the
+//content hashes of both genomes, so a mutated genome simply doesn't find its old entries anymore.
+//When full the least recently used entry is replaced
+class NEATSHOOTER_API FCompatibilityCache
+{
+private:
+	//order independent key of a pair of genome contents
+	struct FSPairKey
+	{
+		uint64 SmallerHash;
+		uint64 BiggerHash;
+
+		FSPairKey() : SmallerHash(0), BiggerHash(0) {}
+		FSPairKey(uint64 hash1, uint64 hash2) : SmallerHash(FMath::Min(hash1, hash2)), BiggerHash(FMath::Max(hash1, hash2)) {}
+
+		bool operator==(const FSPairKey &other) const { return (SmallerHash == other.SmallerHash) && (BiggerHash == other.BiggerHash); }
+		friend uint32 GetTypeHash(const FSPairKey &key) { return HashCombine(GetTypeHash(key.SmallerHash), GetTypeHash(key.BiggerHash)); }
+	};
+
+	//entries form a list from most to least recently used through their indices
+	struct FSEntry
+	{
+		FSPairKey Key;
+		FSCompatibilityResult Result;
+		int Prev;
+		int Next;
+	};
+
+	TArray<FSEntry> m_Entries;
+	TMap<FSPairKey, int> m_Lookup;
+
+	int m_iHead;
+	int m_iTail;
+	int m_iCapacity;
+
+	//the results are only valid for the coefficients they were computed with
+	FSCompatibilityCoefficients m_Coefficients;
+
+	//lookups and hits since the hit rate was last consumed
+	int m_iNumLookups;
+	int m_iNumHits;
+
+	void Unlink(int entry);
+	void LinkFront(int entry);
+
+public:
+	FCompatibilityCache();
+
+	//Sets the maximum number of entries and empties the cache if the coefficients or the capacity changed
+	void Prepare(int capacity, const FSCompatibilityCoefficients &coefficients);
+
+	void Clear();
+
+	//Returns the index of the entry for the two contents or -1. Doesn't change the cache, so several threads may look up at once
+	//as long as nobody adds or touches entries
+	int Find(uint64 hash1, uint64 hash2) const;
+
+	const FSCompatibilityResult& GetResult(int entry) const { return m_Entries[entry].Result; }
+
+	//Marks the entry as just used
+	void Touch(int entry);
+
+	//Stores a result, replacing the least recently used entry when full
+	void Add(uint64 hash1, uint64 hash2, const FSCompatibilityResult &result);
+
+	void RecordLookups(int numLookups, int numHits);
+
+	//Returns the share of lookups answered by the cache since the last call
+	double ConsumeHitRate();
+
+	int Num() const { return m_Lookup.Num(); }
+	bool IsEnabled() const { return m_iCapacity > 0; }
+};
@@ -73,9 +73,9 @@ void ADestructible::OnHit(UPrimitiveComponent* HitComp, AActor* OtherActor, UPri
 	{
 		if (Cast<AProjectile>(OtherActor))
 		{
+			m_GameMode->AwardFitnessForKill(OtherActor, GetActorLocation(), m_fFitnessForKill);
 			Destroy();
 			OtherActor->Destroy();
-			m_GameMode->AwardFitnessToCurrentPlayer(m_fFitnessForKill);
 		}
 	}
 }
@@ -95,6 +95,7 @@ void AEnemySpaceship::OnFire()
 				// find launch direction
 				FVector LaunchDir = ShipRotation.Vector();
 				Projectile->InitVelocity(LaunchDir);
+				Projectile->SetOwner(this);
 			}
 		}
 	}
@@ -106,9 +107,9 @@ void AEnemySpaceship::OnHit(UPrimitiveComponent* HitComp, AActor* OtherActor, UP
 	{
 		if (Cast<AProjectile>(OtherActor))
 		{
+			m_GameMode->AwardFitnessForKill(OtherActor, GetActorLocation(), m_fFitnessForKill);
 			Destroy();
 			OtherActor->Destroy();
-			m_GameMode->AwardFitnessToCurrentPlayer(m_fFitnessForKill);
 		}
 	}
 }
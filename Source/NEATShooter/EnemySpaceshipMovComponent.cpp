@@ -72,3 +72,8 @@ void UEnemySpaceshipMovComponent::SetHorizSpeed(float HorizSpeed)
 {
 	m_HorizSpeed = HorizSpeed;
 }
+
+void UEnemySpaceshipMovComponent::SetSpawnZone(const FSpawnZone& SpawnZone)
+{
+	m_SpawnZone = SpawnZone;
+}
@@ -51,4 +51,6 @@ public:
 
 	void SetVertSpeed(float VertSpeed);
 	void SetHorizSpeed(float HorizSpeed);
+	//the lane the ship bounces in, defaults to the spawn zone of the game mode
+	void SetSpawnZone(const FSpawnZone& SpawnZone);
 };
@@ -0,0 +1,131 @@
+//Copyright 2018 Raphael Haucke
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+//http ://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+
+#include "EpisodeScheduler.h"
+#include "Parameters.h"
+
+
+
+FEpisodeScheduler::FEpisodeScheduler()
+{
+	m_Parameters = nullptr;
+	m_iEpisodesPlayed = 0;
+	m_iBudget = 0;
+	m_iMinEpisodes = 1;
+	m_iMaxEpisodes = 1;
+}
+
+void FEpisodeScheduler::Initialize(const UParameters* parameters)
+{
+	m_Parameters = parameters;
+}
+
+void FEpisodeScheduler::Begin(int numGenomes, int numScenarios)
+{
+	m_Stats.Reset();
+	m_Stats.SetNum(numGenomes);
+	m_iEpisodesPlayed = 0;
+
+	//a repeated scenario plays out the same and would only shrink the variance
+	int NumScenarios = FMath::Max(1, numScenarios);
+	if (m_Parameters->iMaxEpisodesPerGenome > NumScenarios || m_Parameters->iMinEpisodesPerGenome > NumScenarios)
+	{
+		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("EpisodeScheduler Begin more episodes per genome than iNumScenarios, using one per scenario"));
+	}
+	m_iMinEpisodes = FMath::Clamp(m_Parameters->iMinEpisodesPerGenome, 1, NumScenarios);
+	m_iMaxEpisodes = FMath::Clamp(m_Parameters->iMaxEpisodesPerGenome, m_iMinEpisodes, NumScenarios);
+
+	//the minimum is always played, even if the budget is smaller
+	m_iBudget = FMath::Max(FMath::CeilToInt(m_Parameters->fEpisodeBudgetPerGenome * numGenomes), m_iMinEpisodes * numGenomes);
+}
+
+double FEpisodeScheduler::GetSurvivalCut() const
+{
+	TArray<double> Means;
+	for (const FSFitnessStats &curStats : m_Stats)
+	{
+		Means.Add(curStats.dMean);
+	}
+	Means.Sort();
+
+	int Index = FMath::Clamp(FMath::FloorToInt((1.0 - m_Parameters->dSurvivalRate) * (Means.Num() - 1)), 0, Means.Num() - 1);
+	return Means[Index];
+}
+
+bool FEpisodeScheduler::NextRound(TArray<int> &outGenomes)
+{
+	outGenomes.Reset();
+
+	for (int i = 0; i < m_Stats.Num(); ++i)
+	{
+		if (m_Stats[i].iCount < m_iMinEpisodes)
+		{
+			outGenomes.Add(i);
+		}
+	}
+	if (outGenomes.Num() > 0)
+	{
+		return true;
+	}
+
+	int BudgetLeft = m_iBudget - m_iEpisodesPlayed;
+	if (BudgetLeft <= 0 || m_Stats.Num() == 0)
+	{
+		return false;
+	}
+
+	//distance to the cut in standard errors, the ones it could go either way for come first
+	double Cut = GetSurvivalCut();
+	TArray<TPair<double, int>> Undecided;
+	//a single episode says nothing about the spread, those are ranked by their plain distance to the cut and go first
+	TArray<TPair<double, int>> NoSpread;
+	for (int i = 0; i < m_Stats.Num(); ++i)
+	{
+		const FSFitnessStats &Stats = m_Stats[i];
+		if (Stats.iCount >= m_iMaxEpisodes)
+		{
+			continue;
+		}
+
+		double StdError = FMath::Sqrt(Stats.GetVariance() / Stats.iCount);
+		double Distance = FMath::Abs(Stats.dMean - Cut);
+
+		if (Stats.iCount < 2)
+		{
+			NoSpread.Add(TPair<double, int>(Distance, i));
+		}
+		else if (Distance <= m_Parameters->fEpisodeConfidenceZ * StdError)
+		{
+			Undecided.Add(TPair<double, int>(StdError > 0.0 ? Distance / StdError : 0.0, i));
+		}
+	}
+
+	auto Closer = [](const TPair<double, int> &a, const TPair<double, int> &b) { return (a.Key < b.Key) || (a.Key == b.Key && a.Value < b.Value); };
+	NoSpread.Sort(Closer);
+	Undecided.Sort(Closer);
+	NoSpread.Append(Undecided);
+
+	for (int i = 0; i < NoSpread.Num() && i < BudgetLeft; ++i)
+	{
+		outGenomes.Add(NoSpread[i].Value);
+	}
+
+	return outGenomes.Num() > 0;
+}
+
+void FEpisodeScheduler::AddResult(int genome, double fitness)
+{
+	m_Stats[genome].Add(fitness);
+	++m_iEpisodesPlayed;
+}
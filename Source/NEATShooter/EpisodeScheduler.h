@@ -0,0 +1,81 @@
+//Copyright 2018 Raphael Haucke
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+//http ://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+class UParameters;
+
+
+//Running mean and variance of the episodes of one genome (Welford), so no episode has to be kept
+struct FSFitnessStats
+{
+	int iCount;
+	double dMean;
+	//sum of squared distances to the mean
+	double dM2;
+
+	FSFitnessStats() : iCount(0), dMean(0.0), dM2(0.0) {}
+
+	void Add(double fitness)
+	{
+		++iCount;
+		double Delta = fitness - dMean;
+		dMean += Delta / iCount;
+		dM2 += Delta * (fitness - dMean);
+	}
+
+	double GetVariance() const { return (iCount > 1) ? dM2 / (iCount - 1) : 0.0; }
+};
+
+//Decides which genomes of a generation play another episode. Every genome plays iMinEpisodesPerGenome, after that only
+//genomes whose confidence interval still contains the survival cut get more, closest first, until the budget is spent.
+//Clear winners and clear losers stop early since more episodes would not change whether they survive
+class NEATSHOOTER_API FEpisodeScheduler
+{
+private:
+	const UParameters* m_Parameters;
+
+	TArray<FSFitnessStats> m_Stats;
+
+	int m_iEpisodesPlayed;
+	int m_iBudget;
+
+	//episodes a genome plays at least and at most this generation
+	int m_iMinEpisodes;
+	int m_iMaxEpisodes;
+
+	//fitness the top dSurvivalRate of the means are above
+	double GetSurvivalCut() const;
+
+public:
+	FEpisodeScheduler();
+
+	void Initialize(const UParameters* parameters);
+
+	//Starts the evaluation of a generation. Every episode of a genome is played in another scenario, so nobody plays more
+	//episodes than there are scenarios
+	void Begin(int numGenomes, int numScenarios);
+
+	//Fills outGenomes with the genomes that play one more episode each. Returns false once nobody gets one
+	bool NextRound(TArray<int> &outGenomes);
+
+	void AddResult(int genome, double fitness);
+
+	const FSFitnessStats& GetStats(int genome) const { return m_Stats[genome]; }
+
+	int GetEpisodesPlayed() const { return m_iEpisodesPlayed; }
+};
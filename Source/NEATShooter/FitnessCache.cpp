@@ -0,0 +1,97 @@
+//Copyright 2018 Raphael Haucke
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+//http ://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+
+#include "FitnessCache.h"
+
+
+
+FFitnessCache::FFitnessCache()
+{
+	m_iNumLookups = 0;
+	m_iNumHits = 0;
+}
+
+void FFitnessCache::Clear()
+{
+	m_Entries.Reset();
+}
+
+bool FFitnessCache::Find(uint64 hash, int32 seed, int generation, double &outFitness)
+{
+	FSEntry* Entry = m_Entries.Find(hash);
+	if (!Entry)
+	{
+		return false;
+	}
+
+	Entry->iLastUsedGeneration = generation;
+	for (const FSSeedResult &curResult : Entry->Results)
+	{
+		if (curResult.Seed == seed)
+		{
+			outFitness = curResult.dFitness;
+			return true;
+		}
+	}
+	return false;
+}
+
+void FFitnessCache::Add(uint64 hash, int32 seed, double fitness, int generation)
+{
+	FSEntry &Entry = m_Entries.FindOrAdd(hash);
+
+	FSSeedResult Result;
+	Result.Seed = seed;
+	Result.dFitness = fitness;
+	Entry.Results.Add(Result);
+	Entry.dSum += fitness;
+	Entry.iLastUsedGeneration = generation;
+}
+
+double FFitnessCache::GetAverage(uint64 hash) const
+{
+	const FSEntry* Entry = m_Entries.Find(hash);
+	if (!Entry || Entry->Results.Num() == 0)
+	{
+		return 0.0;
+	}
+	return Entry->dSum / Entry->Results.Num();
+}
+
+void FFitnessCache::RemoveUnused(int generation)
+{
+	for (auto It = m_Entries.CreateIterator(); It; ++It)
+	{
+		if (It.Value().iLastUsedGeneration < generation)
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+void FFitnessCache::RecordLookups(int numLookups, int numHits)
+{
+	m_iNumLookups += numLookups;
+	m_iNumHits += numHits;
+}
+
+double FFitnessCache::ConsumeHitRate()
+{
+	double HitRate = (m_iNumLookups > 0) ? double(m_iNumHits) / m_iNumLookups : 0.0;
+
+	m_iNumLookups = 0;
+	m_iNumHits = 0;
+
+	return HitRate;
+}
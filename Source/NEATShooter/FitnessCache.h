@@ -0,0 +1,72 @@
+//Copyright 2018 Raphael Haucke
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+//http ://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+//Remembers the fitness genome contents reached in seeded scenarios. Every headless run starts with cleared activations,
+//so the same content always plays the same scenario the same way and a genome that is carried over unchanged or appears
+//twice does not have to play it again. bVerifyFitnessCache replays the hits to check that this holds.
+//Entries of contents that were not used in a generation are dropped
+class NEATSHOOTER_API FFitnessCache
+{
+private:
+	struct FSSeedResult
+	{
+		int32 Seed;
+		double dFitness;
+	};
+
+	struct FSEntry
+	{
+		//one per scenario the content played
+		TArray<FSSeedResult> Results;
+		double dSum;
+		int iLastUsedGeneration;
+
+		FSEntry() : dSum(0.0), iLastUsedGeneration(0) {}
+	};
+
+	TMap<uint64, FSEntry> m_Entries;
+
+	//lookups and hits since the hit rate was last consumed
+	int m_iNumLookups;
+	int m_iNumHits;
+
+public:
+	FFitnessCache();
+
+	void Clear();
+
+	//Looks for the fitness the content reached in the scenario of the seed and keeps the entry for the generation
+	bool Find(uint64 hash, int32 seed, int generation, double &outFitness);
+
+	//Stores the fitness of a content in a scenario it has not played yet
+	void Add(uint64 hash, int32 seed, double fitness, int generation);
+
+	//Mean over all scenarios the content played
+	double GetAverage(uint64 hash) const;
+
+	//Drops the contents that were not used in the generation
+	void RemoveUnused(int generation);
+
+	void RecordLookups(int numLookups, int numHits);
+
+	//Returns the share of lookups answered by the cache since the last call
+	double ConsumeHitRate();
+
+	int Num() const { return m_Entries.Num(); }
+};
@@ -0,0 +1,121 @@
+//Copyright 2018 Raphael Haucke
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+//http ://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+
+#include "FitnessRace.h"
+#include "Parameters.h"
+
+
+
+FFitnessRace::FFitnessRace()
+{
+	m_Parameters = nullptr;
+	m_iNumStopped = 0;
+	m_fSecondsSaved = 0.f;
+}
+
+void FFitnessRace::Initialize(const UParameters* parameters)
+{
+	m_Parameters = parameters;
+	BeginGeneration();
+}
+
+void FFitnessRace::BeginGeneration()
+{
+	m_Checkpoints.Reset();
+	m_FinalFitness.Reset();
+
+	//checkpoints are only needed to stop runs early
+	if (!m_Parameters->bEarlyTermination)
+	{
+		return;
+	}
+	if (m_Parameters->fRaceCheckpointInterval <= 0.f)
+	{
+		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("FitnessRace BeginGeneration fRaceCheckpointInterval has to be positive"));
+		return;
+	}
+
+	int NumCheckpoints = FMath::Max(0, FMath::FloorToInt(m_Parameters->fTimeLeftToPlay / m_Parameters->fRaceCheckpointInterval));
+	m_Checkpoints.SetNum(NumCheckpoints);
+}
+
+float FFitnessRace::Quantile(TArray<float> samples, float q)
+{
+	samples.Sort();
+	int Index = FMath::Clamp(FMath::FloorToInt(q * (samples.Num() - 1)), 0, samples.Num() - 1);
+	return samples[Index];
+}
+
+bool FFitnessRace::CheckRun(FSRaceRun &run, float timePlayed, float fitness, double &outEstimate)
+{
+	int Checkpoint = run.CheckpointFitness.Num();
+	if (!m_Checkpoints.IsValidIndex(Checkpoint) || timePlayed < (Checkpoint + 1) * m_Parameters->fRaceCheckpointInterval)
+	{
+		return false;
+	}
+	run.CheckpointFitness.Add(fitness);
+
+	if (!m_Parameters->bEarlyTermination)
+	{
+		return false;
+	}
+
+	//too few runs got here to tell where this one stands
+	const FSCheckpoint& Samples = m_Checkpoints[Checkpoint];
+	if (Samples.Fitness.Num() < FMath::Max(1, m_Parameters->iRaceMinSamples))
+	{
+		return false;
+	}
+
+	if (fitness >= Quantile(Samples.Fitness, m_Parameters->fRaceBand))
+	{
+		return false;
+	}
+
+	//the best any finished run did from here on
+	float UpperBound = fitness + FMath::Max(Samples.RemainingGain);
+	float SurvivalCut = Quantile(m_FinalFitness, 1.f - float(m_Parameters->dSurvivalRate));
+	if (UpperBound >= SurvivalCut)
+	{
+		return false;
+	}
+
+	//the worst any finished run did from here on, the run doesn't get the benefit of the doubt
+	outEstimate = fitness + FMath::Min(Samples.RemainingGain);
+
+	//the stopped run counts for the cut like a finished one, otherwise every stop would raise it for the next run
+	m_FinalFitness.Add(float(outEstimate));
+
+	++m_iNumStopped;
+	m_fSecondsSaved += FMath::Max(0.f, m_Parameters->fTimeLeftToPlay - timePlayed);
+	return true;
+}
+
+void FFitnessRace::FinishRun(const FSRaceRun &run, float finalFitness)
+{
+	for (int i = 0; i < run.CheckpointFitness.Num() && i < m_Checkpoints.Num(); ++i)
+	{
+		m_Checkpoints[i].Fitness.Add(run.CheckpointFitness[i]);
+		m_Checkpoints[i].RemainingGain.Add(finalFitness - run.CheckpointFitness[i]);
+	}
+	m_FinalFitness.Add(finalFitness);
+}
+
+void FFitnessRace::ConsumeStats(int &outNumStopped, float &outSecondsSaved)
+{
+	outNumStopped = m_iNumStopped;
+	outSecondsSaved = m_fSecondsSaved;
+	m_iNumStopped = 0;
+	m_fSecondsSaved = 0.f;
+}
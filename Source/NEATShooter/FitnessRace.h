@@ -0,0 +1,74 @@
+//Copyright 2018 Raphael Haucke
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+//http ://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+class UParameters;
+
+
+//Fitness of one run at the checkpoints it has passed so far
+struct FSRaceRun
+{
+	TArray<float> CheckpointFitness;
+
+	void Reset() { CheckpointFitness.Reset(); }
+};
+
+//Early termination of runs that fall clearly behind the rest of the generation. Every finished run leaves its fitness at
+//fixed checkpoints and what it gained from there to the end. A later run is stopped at a checkpoint once it is in the
+//lower band of the runs that passed it and even the biggest gain seen from there would not lift it to the survival cut
+class NEATSHOOTER_API FFitnessRace
+{
+private:
+	//samples of the finished runs of this generation at one checkpoint
+	struct FSCheckpoint
+	{
+		TArray<float> Fitness;
+		TArray<float> RemainingGain;
+	};
+
+	const UParameters* m_Parameters;
+
+	TArray<FSCheckpoint> m_Checkpoints;
+
+	//final fitness of all runs of this generation, stopped runs with their estimate
+	TArray<float> m_FinalFitness;
+
+	//stopped runs and the episode time they did not have to play since the stats were last consumed
+	int m_iNumStopped;
+	float m_fSecondsSaved;
+
+	//value at the share q of the sorted samples
+	static float Quantile(TArray<float> samples, float q);
+
+public:
+	FFitnessRace();
+
+	void Initialize(const UParameters* parameters);
+
+	//Forgets the samples of the last generation
+	void BeginGeneration();
+
+	//Records the checkpoints the run passed. Returns true if it should be stopped, outEstimate is then the fitness it gets
+	bool CheckRun(FSRaceRun &run, float timePlayed, float fitness, double &outEstimate);
+
+	//A run that was played to the end leaves its samples for the following ones
+	void FinishRun(const FSRaceRun &run, float finalFitness);
+
+	//Returns the stopped runs and the seconds they saved since the last call
+	void ConsumeStats(int &outNumStopped, float &outSecondsSaved);
+};
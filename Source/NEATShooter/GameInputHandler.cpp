@@ -73,16 +73,33 @@ void AGameInputHandler::SetupPlayerInputComponent(UInputComponent* PlayerInputCo
 
 void AGameInputHandler::AccelerateGame()
 {
+	//time dilation would only stretch the fixed steps, so they are run more often instead
+	if (m_GameMode->IsFixedStepSimulation())
+	{
+		m_GameMode->ChangeSimulationSpeed(1.f);
+		return;
+	}
 	GetWorldSettings()->TimeDilation += 1.f;
 }
 
 void AGameInputHandler::ResetGameSpeed()
 {
+	if (m_GameMode->IsFixedStepSimulation())
+	{
+		m_GameMode->ResetSimulationSpeed();
+		return;
+	}
 	GetWorldSettings()->TimeDilation = 1.f;
 }
 
 void AGameInputHandler::FastForward()
 {
+	//as fast as the frame budget allows
+	if (m_GameMode->IsFixedStepSimulation())
+	{
+		m_GameMode->SetUncappedSpeed(true);
+		return;
+	}
 	GetWorldSettings()->TimeDilation += 50.f;
 }
 
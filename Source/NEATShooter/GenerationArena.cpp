@@ -0,0 +1,95 @@
+//Copyright 2018 Raphael Haucke
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+//http ://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+
+#include "GenerationArena.h"
+
+
+
+FGenerationArena::FGenerationArena()
+{
+	m_iCurrentBlock = 0;
+	m_CurrentOffset = 0;
+	m_BytesInUse = 0;
+	m_PeakBytes = 0;
+	m_LastPeakBytes = 0;
+	m_iResetCount = 0;
+}
+
+FGenerationArena::~FGenerationArena()
+{
+	Release();
+}
+
+void* FGenerationArena::Allocate(SIZE_T size, SIZE_T alignment)
+{
+	FScopeLock ArenaLock(&m_Lock);
+
+	//look for a block with enough room left, starting with the current one
+	while (m_iCurrentBlock < m_Blocks.Num())
+	{
+		FSBlock& CurBlock = m_Blocks[m_iCurrentBlock];
+		SIZE_T AlignedOffset = Align(m_CurrentOffset, alignment);
+
+		if (AlignedOffset + size <= CurBlock.Size)
+		{
+			m_BytesInUse += (AlignedOffset - m_CurrentOffset) + size;
+			m_PeakBytes = FMath::Max(m_PeakBytes, m_BytesInUse);
+			m_CurrentOffset = AlignedOffset + size;
+			return CurBlock.Memory + AlignedOffset;
+		}
+
+		//the rest of this block is wasted until the next reset
+		m_BytesInUse += CurBlock.Size - m_CurrentOffset;
+		++m_iCurrentBlock;
+		m_CurrentOffset = 0;
+	}
+
+	//no block left, big allocations get a block of their own size
+	FSBlock NewBlock;
+	NewBlock.Size = FMath::Max(DefaultBlockSize, size + alignment);
+	NewBlock.Memory = (uint8*)FMemory::Malloc(NewBlock.Size, FMath::Max<SIZE_T>(alignment, 16));
+	m_Blocks.Add(NewBlock);
+
+	m_iCurrentBlock = m_Blocks.Num() - 1;
+	m_CurrentOffset = size;
+	m_BytesInUse += size;
+	m_PeakBytes = FMath::Max(m_PeakBytes, m_BytesInUse);
+
+	return NewBlock.Memory;
+}
+
+void FGenerationArena::Reset()
+{
+	FScopeLock ArenaLock(&m_Lock);
+
+	m_LastPeakBytes = m_PeakBytes;
+	m_iCurrentBlock = 0;
+	m_CurrentOffset = 0;
+	m_BytesInUse = 0;
+	m_PeakBytes = 0;
+	++m_iResetCount;
+}
+
+void FGenerationArena::Release()
+{
+	Reset();
+
+	FScopeLock ArenaLock(&m_Lock);
+
+	for (FSBlock& curBlock : m_Blocks)
+	{
+		FMemory::Free(curBlock.Memory);
+	}
+	m_Blocks.Empty();
+}
@@ -0,0 +1,95 @@
+//Copyright 2018 Raphael Haucke
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+//http ://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/IsTriviallyDestructible.h"
+
+
+//Bump pointer allocator for data that lives exactly one generation (compiled networks). Memory is carved out of big blocks
+//and handed back all at once by Reset, the blocks themselves are kept for the next generation.
+//Destructors are never called, so only trivially destructible types may be allocated. Nothing in here is seen by the GC,
+//never point a UPROPERTY into an arena
+class NEATSHOOTER_API FGenerationArena
+{
+private:
+	struct FSBlock
+	{
+		uint8* Memory;
+		SIZE_T Size;
+	};
+
+	TArray<FSBlock> m_Blocks;
+
+	//block we are currently bumping in and the offset of the next free byte in it
+	int m_iCurrentBlock;
+	SIZE_T m_CurrentOffset;
+
+	SIZE_T m_BytesInUse;
+	//highest m_BytesInUse since the last reset
+	SIZE_T m_PeakBytes;
+	SIZE_T m_LastPeakBytes;
+
+	//incremented on every reset, allocations remember it to detect use after reset
+	uint32 m_iResetCount;
+
+	//phenotypes may be compiled from worker threads
+	FCriticalSection m_Lock;
+
+	FGenerationArena(const FGenerationArena&) = delete;
+	FGenerationArena& operator=(const FGenerationArena&) = delete;
+
+public:
+	static const SIZE_T DefaultBlockSize = 256 * 1024;
+
+	FGenerationArena();
+	~FGenerationArena();
+
+	//Returns uninitialized memory that stays valid until the next Reset
+	void* Allocate(SIZE_T size, SIZE_T alignment);
+
+	//Returns count default constructed elements
+	template<typename T>
+	T* AllocateArray(int count)
+	{
+		static_assert(TIsTriviallyDestructible<T>::Value, "FGenerationArena never calls destructors");
+
+		if (count <= 0)
+		{
+			return nullptr;
+		}
+
+		T* Result = (T*)Allocate(sizeof(T) * count, alignof(T));
+		for (int i = 0; i < count; ++i)
+		{
+			new(Result + i) T();
+		}
+		return Result;
+	}
+
+	//Frees everything allocated so far in one go
+	void Reset();
+
+	//Gives the blocks back to the system
+	void Release();
+
+
+
+	SIZE_T GetBytesInUse() const { return m_BytesInUse; }
+	SIZE_T GetPeakBytes() const { return m_PeakBytes; }
+	//peak of the generation before the last reset
+	SIZE_T GetLastPeakBytes() const { return m_LastPeakBytes; }
+	uint32 GetResetCount() const { return m_iResetCount; }
+};
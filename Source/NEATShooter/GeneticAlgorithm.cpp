@@ -20,6 +20,11 @@
 #include "Innovation.h"
 #include "Parameters.h"
 #include "Queue.h"
+#include "HAL/PlatformTime.h"
+#include "Async/ParallelFor.h"
+#include "Compatibility.h"
+#include "CompatibilityCache.h"
+#include "SpeciesLeaderIndex.h"
 #include "MyGameMode.h"
 
 
@@ -31,6 +36,7 @@ UGeneticAlgorithm::UGeneticAlgorithm()
 void UGeneticAlgorithm::Initialize(int populationSize, int numInputs, int numOutputs, AMyGameMode* gameMode)
 {
 	m_iGeneration = 1;
+	m_iIsland = 0;
 	m_iPopSize = populationSize;
 	m_iNextGenomeID = 0;
 	m_Innovation = nullptr;
@@ -40,6 +46,15 @@ void UGeneticAlgorithm::Initialize(int populationSize, int numInputs, int numOut
 	m_dAverageAdjustedFitness = 0.0;
 	m_GameMode = gameMode;
 	m_Parameters = m_GameMode->GetParameters();
+	m_iCurrentArena = 0;
+	m_iGeneAllocationsLastGen = 0;
+	m_dCrossoverSecondsLastGen = 0.0;
+	m_iCrossoversLastGen = 0;
+	m_iReplacements = 0;
+	m_iEvaluationsSinceReplacement = 0;
+	m_EpochPhase = EpochIdle;
+	m_iNextOffspringTask = 0;
+	m_EvaluationCounts.Init(0, m_iPopSize);
 
 	//create population of start genomes
 	for (int i = 0; i < m_iPopSize; ++i)
@@ -58,172 +73,376 @@ void UGeneticAlgorithm::Initialize(int populationSize, int numInputs, int numOut
 
 	//create the network depth lookup table
 	m_FSplitDepths = Split(0, 1, 0);
+
+	//the start population doesn't count towards the first epoch
+	UGenome::ConsumeGeneStorageAllocations();
 }
 
 TArray<UNeuralNet*> UGeneticAlgorithm::Epoch(TArray<double>& vGenotypeFitness)
 {
-	if (vGenotypeFitness.Num() != m_Genomes.Num())
+	BeginEpoch(vGenotypeFitness);
+
+	//no budget, the whole generation is built in this call
+	StepEpoch(0.0);
+
+	return FinishEpoch();
+}
+
+void UGeneticAlgorithm::BeginEpoch(const TArray<double> &fitnessScores)
+{
+	if (fitnessScores.Num() != m_Genomes.Num())
 	{
 		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT(" GeneticAlgorithm Epoch() Not enough fittness scores"));
 	}
 
-	//ready for next generation
-	ResetAndKill();
+	m_EpochFitness = fitnessScores;
+	m_EpochPhase = EpochSort;
+}
 
-	//assign the restulting fitness of the game run to the respective genome
-	for (int i = 0; i < m_Genomes.Num(); ++i)
+bool UGeneticAlgorithm::StepEpoch(double budgetSeconds)
+{
+	const double Deadline = FPlatformTime::Seconds() + budgetSeconds;
+
+	//at least one piece of work per call, so a small budget still makes progress
+	bool bFirstStep = true;
+
+	while (m_EpochPhase != EpochIdle && m_EpochPhase != EpochDone)
 	{
-		m_Genomes[i]->SetFitness(vGenotypeFitness[i]);
-	}
+		if (!bFirstStep && (budgetSeconds > 0.0) && (FPlatformTime::Seconds() >= Deadline))
+		{
+			return false;
+		}
+		bFirstStep = false;
 
-	//sort genomes and keep a record of the best performers
-	SortAndRecord();
+		switch (m_EpochPhase)
+		{
+		case EpochSort:
+			//ready for next generation
+			ResetAndKill();
 
-	//speciate
-	SpeciateAndCalculateSpawnAmounts();
+			//assign the restulting fitness of the game run to the respective genome
+			for (int i = 0; i < m_Genomes.Num(); ++i)
+			{
+				m_Genomes[i]->SetFitness(m_EpochFitness[i]);
+			}
 
-	//calc stats for records
-	for (UGenome* curGenome : m_Genomes)
-	{
-		m_AvgNumLinksLastGen += curGenome->GetNumLinkGenes();
-		m_AvgNumNeuronsLastGen += curGenome->GetNumNeuronGenes();
-	}
+			//sort genomes and keep a record of the best performers
+			SortAndRecord();
+			m_EpochPhase = EpochSpeciate;
+			break;
 
-	m_AvgNumLinksLastGen /= m_Genomes.Num();
-	m_AvgNumNeuronsLastGen /= m_Genomes.Num();
+		case EpochSpeciate:
+			Speciate();
+			m_EpochPhase = EpochSpawnAmounts;
+			break;
 
+		case EpochSpawnAmounts:
+			CalculateSpawnAmounts();
 
-	//the next generation of genomes
-	TArray<UGenome*> NextGeneration;
+			//calc stats for records
+			for (UGenome* curGenome : m_Genomes)
+			{
+				m_AvgNumLinksLastGen += curGenome->GetNumLinkGenes();
+				m_AvgNumNeuronsLastGen += curGenome->GetNumNeuronGenes();
+			}
 
-	int NextGenSize = 0;
-	UGenome* NextChild = nullptr;
+			m_AvgNumLinksLastGen /= m_Genomes.Num();
+			m_AvgNumNeuronsLastGen /= m_Genomes.Num();
 
-	//go through all species
-	for (USpecies* curSpecies : m_Species)
-	{
-		//check if already done with next generation
-		if (NextGenSize < m_Parameters->iPopulationSize)
-		{
-			//species spawn amount is a double which needs to be rounded to an integer
-			int NumToSpawn = Round(curSpecies->GetNumToSpawn());
+			PrepareOffspring();
+			m_EpochPhase = EpochReproduce;
+			break;
 
-			bool bChosenBestYet = false;
+		case EpochReproduce:
+			//as many species as there are threads at a time
+			if (m_iNextOffspringTask < m_OffspringTasks.Num())
+			{
+				int BatchSize = FMath::Max(FTaskGraphInterface::Get().GetNumWorkerThreads() + 1, 1);
+				int NumTasks = FMath::Min(BatchSize, m_OffspringTasks.Num() - m_iNextOffspringTask);
+				ProduceOffspringBatch(m_iNextOffspringTask, NumTasks);
+				m_iNextOffspringTask += NumTasks;
+			}
+			else
+			{
+				MergeOffspring();
+				m_EpochPhase = EpochMutate;
+			}
+			break;
+
+		case EpochMutate:
+			MutateChildren(m_MutatedChildren);
+			FillPopulation();
 
-			//as long as current species is allowed to generate offspring
-			while (NumToSpawn > 0)
+			//delete last generation and assign the next one
+			m_Genomes = m_NextGeneration;
+			m_NextGeneration.Empty();
+			m_MutatedChildren.Empty();
+
+			SwapArenas();
+			m_NewNetworks.Empty();
+			m_EpochPhase = EpochCompile;
+			break;
+
+		case EpochCompile:
+			//create phenotypes, one per step
+			if (m_NewNetworks.Num() < m_Genomes.Num())
 			{
-				//copy leader of current species (per species elitism) once
-				if (!bChosenBestYet)
-				{
-					NextChild = NewObject<UGenome>(this, UGenome::StaticClass(), NAME_None, RF_NoFlags, curSpecies->GetLeader());
-					bChosenBestYet = true;
-				}
-				else
-				{
-					//if the number of individuals in this species is only one then we can't crossover
-					if (curSpecies->GetNumMembers() == 1)
-					{
-						NextChild = NewObject<UGenome>(this, UGenome::StaticClass(), NAME_None, RF_NoFlags, curSpecies->GetTopGenome());
-					}
-					//if greater than one we can use the crossover operator
-					else
-					{
-						//select first parent
-						UGenome* MotherGenome = NewObject<UGenome>(this, UGenome::StaticClass(), NAME_None, RF_NoFlags, curSpecies->GetTopGenome());
-						//do we crossover?
-						if (RandFloat() < m_Parameters->dCrossoverRate)
-						{
-							//select second parent
-							UGenome* FatherGenome = NewObject<UGenome>(this, UGenome::StaticClass(), NAME_None, RF_NoFlags, curSpecies->GetTopGenome());
-							int NumAttempts = m_Parameters->iCrossoverTries;
-
-							//father needs to be different from mother
-							while ((MotherGenome->GetID() == FatherGenome->GetID()) && (NumAttempts > 0))
-							{
-								FatherGenome = NewObject<UGenome>(this, UGenome::StaticClass(), NAME_None, RF_NoFlags, curSpecies->GetTopGenome());
-								--NumAttempts;
-							}
-
-							//two different parents, do crossover
-							if (MotherGenome->GetID() != FatherGenome->GetID())
-							{
-								NextChild = Crossover(MotherGenome, FatherGenome);
-							}
-						}
-						//couldn't find partner, child is mother
-						else
-						{
-							NextChild = MotherGenome;
-						}
-
-						//mutate the child
-						if (NextChild->GetNumNeuronGenes() < m_Parameters->iMaxPermittedNeurons)
-						{
-							NextChild->MutateAddNode(*m_Innovation, m_Parameters->dChanceAddNode, m_Parameters->iNumTriesAddNode);
-						}
-
-						NextChild->MutateAddLink(*m_Innovation, m_Parameters->dChanceAddLink, m_Parameters->iNumTriesAddLink);
-						NextChild->MutateWeights(m_Parameters->dMaxWeightMutationPower, m_Parameters->dWeightMutationRate, m_Parameters->dNewWeightChance);
-						NextChild->ToggleLinkGenes(m_Parameters->dToggleLinkRate, m_Parameters->iNumTriesToggle);
-						NextChild->ReenableLinkGenes(m_Parameters->dEnableLinkRate);
-
-						//sort link genes of the new generation member
-						NextChild->SortGenes();
-					}
-					//give the offspring its ID
-					NextChild->SetID(m_iNextGenomeID);
-					++m_iNextGenomeID;
-				}
-				//add child to new pop
-				NextGeneration.Add(NextChild);
-				--NumToSpawn;
-				++NextGenSize;
+				UGenome* Genome = m_Genomes[m_NewNetworks.Num()];
+				Genome->CalculateNetDepth(m_FSplitDepths);
+				m_NewNetworks.Emplace(Genome->CreatePhenotype(&m_Arenas[m_iCurrentArena]));
+			}
+			else
+			{
+				//gene storages created while building this generation
+				m_iGeneAllocationsLastGen = UGenome::ConsumeGeneStorageAllocations();
 
-				if (NextGenSize == m_Parameters->iPopulationSize)
-				{
-					NumToSpawn = 0;
-				}
+				//generation done
+				++m_iGeneration;
+				m_EpochPhase = EpochDone;
 			}
+			break;
+
+		default:
+			break;
 		}
-	}//next species
+	}
+
+	return m_EpochPhase == EpochDone;
+}
+
+TArray<UNeuralNet*> UGeneticAlgorithm::FinishEpoch()
+{
+	if (m_EpochPhase != EpochDone)
+	{
+		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("GeneticAlgorithm FinishEpoch() epoch isn't done yet"));
+	}
+
+	m_EpochPhase = EpochIdle;
+	m_EpochFitness.Empty();
+
+	TArray<UNeuralNet*> NewNetworks = MoveTemp(m_NewNetworks);
+	m_NewNetworks.Empty();
+	return NewNetworks;
+}
+
+void UGeneticAlgorithm::FillPopulation()
+{
+	int NextGenSize = m_NextGeneration.Num();
 
 	 //if there is an underflow due to the rounding error and the amount
 	 //of offspring falls short of the population size, additional children
 	 //need to be created and added to the new population. This is achieved
 	 //by using tournament selection over the entire population.
-	if (NextGenSize < m_Parameters->iPopulationSize)
+	if (NextGenSize < m_iPopSize)
 	{
 		//calculate amount of additional children required
-		int ChildrenRequired = m_Parameters->iPopulationSize - NextGenSize;
+		int ChildrenRequired = m_iPopSize - NextGenSize;
+
+		//the odds only depend on the fitness ranks, so they are worked out once for all draws
+		BuildTournamentTable(m_Parameters->iNumTriesForSelection);
+		FRandomStream Rng = CreateRandomStream(SelectionStream, 0);
 
 		while (ChildrenRequired > 0)
 		{
-			NextGeneration.Add(TournamentSelection(m_Parameters->iNumTriesForSelection));
+			m_NextGeneration.Add(TournamentSelection(Rng));
 			--ChildrenRequired;
 		}
 	}
+}
 
-	//delete last generation and assign the next one
-	m_Genomes.Empty();
-	m_Genomes = NextGeneration;
 
-	//create phenotypes
-	TArray<UNeuralNet*> TempNeuralNets;
+void UGeneticAlgorithm::PrepareOffspring()
+{
+	//decide how many children each species gets and which IDs they use, in species order like the sequential loop did
+	m_OffspringTasks.Reset();
+	m_iNextOffspringTask = 0;
+	int NextGenSize = 0;
 
-	for (UGenome* genome : m_Genomes)
+	for (USpecies* curSpecies : m_Species)
 	{
-		genome->CalculateNetDepth(m_FSplitDepths);
-		UNeuralNet* TempNeuralNet = genome->CreatePhenotype();
-		TempNeuralNets.Emplace(TempNeuralNet);
+		FSOffspringTask Task;
+		Task.Species = curSpecies;
+		Task.FirstChild = NextGenSize;
+
+		//species spawn amount is a double which needs to be rounded to an integer. Stop once the population is full
+		Task.NumChildren = FMath::Clamp(Round(curSpecies->GetNumToSpawn()), 0, m_iPopSize - NextGenSize);
+
+		//the copy of the leader keeps its ID, all other children get a new one
+		Task.FirstID = m_iNextGenomeID;
+		m_iNextGenomeID += FMath::Max(Task.NumChildren - 1, 0);
+
+		NextGenSize += Task.NumChildren;
+		m_OffspringTasks.Add(Task);
 	}
 
-	//generation done
-	++m_iGeneration;
+	//UObjects can only be created on the game thread, the workers fill in empty genomes
+	m_OffspringChildren.SetNumUninitialized(NextGenSize);
+	m_OffspringMutated.Reset();
+	m_OffspringMutated.SetNumZeroed(NextGenSize);
+	for (int i = 0; i < NextGenSize; ++i)
+	{
+		m_OffspringChildren[i] = NewObject<UGenome>(this);
+	}
+
+	//every task needs its own crossover memory
+	if (m_CrossoverScratches.Num() < m_OffspringTasks.Num())
+	{
+		m_CrossoverScratches.SetNum(m_OffspringTasks.Num());
+	}
+}
+
+void UGeneticAlgorithm::ProduceOffspringBatch(int firstTask, int numTasks)
+{
+	ParallelFor(numTasks, [&](int32 BatchIndex)
+	{
+		const int TaskIndex = firstTask + BatchIndex;
+		ProduceOffspring(m_OffspringTasks[TaskIndex], m_OffspringChildren, m_OffspringMutated, m_CrossoverScratches[TaskIndex]);
+	});
+}
+
+void UGeneticAlgorithm::MergeOffspring()
+{
+	//merge in species order
+	for (const FSOffspringTask &Task : m_OffspringTasks)
+	{
+		m_dCrossoverSecondsLastGen += Task.CrossoverSeconds;
+		m_iCrossoversLastGen += Task.NumCrossovers;
+	}
+
+	for (int i = 0; i < m_OffspringChildren.Num(); ++i)
+	{
+		m_NextGeneration.Add(m_OffspringChildren[i]);
+
+		if (m_OffspringMutated[i])
+		{
+			m_MutatedChildren.Add(m_OffspringChildren[i]);
+		}
+	}
+
+	m_OffspringTasks.Reset();
+	m_OffspringChildren.Reset();
+}
+
+void UGeneticAlgorithm::ProduceOffspring(FSOffspringTask &task, const TArray<UGenome*> &children, TArray<bool> &mutated, FSCrossoverScratch &scratch)
+{
+	USpecies* curSpecies = task.Species;
+
+	//the stream depends on the species, not on the thread or on what other species drew
+	FRandomStream Rng = CreateRandomStream(ReproductionStream, curSpecies->GetSpeciesID());
+
+	int NextID = task.FirstID;
+
+	for (int i = 0; i < task.NumChildren; ++i)
+	{
+		const int ChildIndex = task.FirstChild + i;
+		UGenome* NextChild = children[ChildIndex];
+
+		//copy leader of current species (per species elitism) once
+		if (i == 0)
+		{
+			NextChild->CopyFrom(curSpecies->GetLeader());
+		}
+		else
+		{
+			//mutated after all children are created
+			mutated[ChildIndex] = BreedChild(task, NextChild, scratch, Rng);
 
-	return TempNeuralNets;
+			//give the offspring its ID
+			NextChild->SetID(NextID);
+			++NextID;
+		}
+	}
 }
 
+bool UGeneticAlgorithm::BreedChild(FSOffspringTask &task, UGenome* child, FSCrossoverScratch &scratch, FRandomStream &rng)
+{
+	USpecies* curSpecies = task.Species;
+
+	//if the number of individuals in this species is only one then we can't crossover
+	if (curSpecies->GetNumMembers() == 1)
+	{
+		child->CopyFrom(curSpecies->GetTopGenome(rng));
+		return false;
+	}
+
+	//select first parent. Parents are only read, so they aren't copied
+	UGenome* MotherGenome = curSpecies->GetTopGenome(rng);
+	//do we crossover?
+	if (RandFloat(rng) < m_Parameters->dCrossoverRate)
+	{
+		//select second parent
+		UGenome* FatherGenome = curSpecies->GetTopGenome(rng);
+		int NumAttempts = m_Parameters->iCrossoverTries;
+
+		//father needs to be different from mother
+		while ((MotherGenome->GetID() == FatherGenome->GetID()) && (NumAttempts > 0))
+		{
+			FatherGenome = curSpecies->GetTopGenome(rng);
+			--NumAttempts;
+		}
+
+		//two different parents, do crossover
+		if (MotherGenome->GetID() != FatherGenome->GetID())
+		{
+			double StartTime = FPlatformTime::Seconds();
+			Crossover(MotherGenome, FatherGenome, child, scratch, rng);
+			task.CrossoverSeconds += FPlatformTime::Seconds() - StartTime;
+			++task.NumCrossovers;
+		}
+		//couldn't find partner, child is mother
+		else
+		{
+			child->CopyFrom(MotherGenome);
+		}
+	}
+	//no crossover, child is mother. It shares the mother's genes until the first mutation writes to them
+	else
+	{
+		child->CopyFrom(MotherGenome);
+	}
+
+	return true;
+}
+
+FRandomStream UGeneticAlgorithm::CreateRandomStream(int purpose, int index) const
+{
+	uint32 Seed = HashCombine(HashCombine(GetTypeHash(m_Parameters->iRandomSeed), GetTypeHash(m_iIsland)), GetTypeHash(m_iGeneration));
+	//steady state mode breeds many times per generation, in generational mode this stays 0
+	Seed = HashCombine(Seed, GetTypeHash(m_iReplacements));
+	Seed = HashCombine(Seed, GetTypeHash(purpose));
+	return FRandomStream(HashCombine(Seed, GetTypeHash(index)));
+}
+
+void UGeneticAlgorithm::MutateChildren(const TArray<UGenome*> &children)
+{
+	//new innovations are only proposed by the children and get their IDs in child order afterwards,
+	//so the IDs don't depend on the order the mutations are carried out in
+	m_Innovation->BeginStaging();
+
+	ParallelFor(children.Num(), [&](int32 ChildIndex)
+	{
+		UGenome* Child = children[ChildIndex];
+
+		//each child has its own stream, the result doesn't depend on the thread that mutates it
+		FRandomStream Rng = CreateRandomStream(MutationStream, ChildIndex);
+
+		if (Child->GetNumNeuronGenes() < m_Parameters->iMaxPermittedNeurons)
+		{
+			Child->MutateAddNode(*m_Innovation, m_Parameters->dChanceAddNode, m_Parameters->iNumTriesAddNode, Rng);
+		}
+
+		Child->MutateAddLink(*m_Innovation, m_Parameters->dChanceAddLink, m_Parameters->iNumTriesAddLink, Rng);
+		Child->MutateWeights(m_Parameters->dMaxWeightMutationPower, m_Parameters->dWeightMutationRate, m_Parameters->dNewWeightChance, Rng);
+		Child->ToggleLinkGenes(m_Parameters->dToggleLinkRate, m_Parameters->iNumTriesToggle, Rng);
+		Child->ReenableLinkGenes(m_Parameters->dEnableLinkRate, Rng);
+
+		//sort link genes of the new generation member
+		Child->SortGenes();
+	});
+
+	//hand out the IDs of this generation's innovations
+	m_Innovation->ResolveStagedInnovations(children);
+}
 
 TArray<UGenome*> UGeneticAlgorithm::GetGenotypes()
 {
@@ -235,36 +454,260 @@ TArray<UGenome*> UGeneticAlgorithm::GetGenotypes()
 	return TempGenotypes;
 }
 
-void UGeneticAlgorithm::SpeciateAndCalculateSpawnAmounts()
+void UGeneticAlgorithm::Speciate()
 {
-	bool bAdded = false;
-
 	//try to keep the number of species at iMaxNumberOfSpecies
 	AdjustCompatibilityThreshold();
 
-	//iterate through each genome and speciate
+	//the threshold and coefficients don't change during the pass
+	const FSCompatibilityCoefficients Coefficients(m_Parameters);
+	const double Threshold = m_Parameters->dCompatibilityThreshold;
+
+	//leaders of the species from the last generation. Their distance to every genome is computed up front on the workers
+	const int NumOldSpecies = m_Species.Num();
+	TArray<UGenome*> OldLeaders;
+	for (USpecies* species : m_Species)
+	{
+		OldLeaders.Add(species->GetLeader());
+		species->GetLeader()->PackLinks();
+		species->GetLeader()->GetContentHash();
+	}
+
+	//genomes can share their genes, so they are packed and hashed here and not on the workers
 	for (UGenome* genome : m_Genomes)
 	{
-		//calculate its compatibility score with each species leader
-		for (USpecies* species : m_Species)
+		genome->PackLinks();
+		genome->GetContentHash();
+	}
+
+	//results from earlier generations stay valid as long as the coefficients are the same
+	m_CompatibilityCache.Prepare(m_Parameters->iCompatibilityCacheSize, Coefficients);
+	const bool bUseCache = m_CompatibilityCache.IsEnabled();
+
+	//signatures of the genomes followed by the ones of the old leaders
+	const bool bUseSignatures = m_Parameters->bBitsetCompatibility;
+	TMap<UGenome*, int> SignatureOfGenome;
+
+	if (bUseSignatures)
+	{
+		BuildSignatures(OldLeaders);
+
+		for (int i = 0; i < m_Genomes.Num(); ++i)
 		{
-			UGenome* SpeciesLeader = species->GetLeader();
-			double Compatibility = genome->GetCompatibilityScore(SpeciesLeader);
+			SignatureOfGenome.Add(m_Genomes[i], i);
+		}
+	}
 
-			//if this individual is similar to this species add to species
-			if (Compatibility <= m_Parameters->dCompatibilityThreshold)
+	//the old leaders measured against each other, so most of them can be ruled out without comparing genes
+	TArray<const FSPackedLinks*> LeaderLinks;
+	TArray<const FSLinkSignature*> LeaderSignatures;
+	for (int i = 0; i < NumOldSpecies; ++i)
+	{
+		LeaderLinks.Add(&OldLeaders[i]->GetPackedLinks());
+		LeaderSignatures.Add(bUseSignatures ? &m_Signatures[m_Genomes.Num() + i] : nullptr);
+	}
+	m_LeaderIndex.Build(LeaderLinks, LeaderSignatures, Coefficients);
+
+	//tests with the signatures if both could be built and with the link lists otherwise
+	auto TestCompatibility = [&](UGenome* member, int memberSignature, UGenome* leader, int leaderSignature)
+	{
+		if (bUseSignatures && (leaderSignature >= 0) && m_Signatures[memberSignature].bValid && m_Signatures[leaderSignature].bValid)
+		{
+			return FCompatibility::TestThreshold(m_Signatures[memberSignature], m_Signatures[leaderSignature], Coefficients, Threshold);
+		}
+		return FCompatibility::TestThreshold(member->GetPackedLinks(), leader->GetPackedLinks(), Coefficients, Threshold);
+	};
+
+	//in nearest match mode every old leader is needed, otherwise the scan can stop at the first compatible one
+	const bool bNearestMatch = m_Parameters->bNearestSpeciesMatch;
+
+	//one entry per genome and old leader. Unknown pairs are tested on the game thread if the sequential pass needs them
+	const int NumPairs = m_Genomes.Num() * NumOldSpecies;
+	TArray<uint8> PairStates;
+	TArray<int> PairCacheEntries;
+	TArray<FSCompatibilityResult> PairResults;
+	PairStates.SetNumZeroed(NumPairs);
+	PairCacheEntries.SetNumUninitialized(NumPairs);
+	PairResults.SetNumUninitialized(NumPairs);
+
+	TArray<int> RuledOutPerGenome;
+	TArray<int> QueriesPerGenome;
+	RuledOutPerGenome.SetNumZeroed(m_Genomes.Num());
+	QueriesPerGenome.SetNumZeroed(m_Genomes.Num());
+
+	//the cache is only read here, it is updated afterwards on the game thread
+	ParallelFor(m_Genomes.Num(), [&](int32 GenomeIndex)
+	{
+		UGenome* Member = m_Genomes[GenomeIndex];
+		const int NumGenes = Member->GetNumLinkGenes();
+
+		//leaders this genome was measured against, pivots for the triangle bound
+		FMeasuredLeaders Measured;
+
+		for (int SpeciesIndex = 0; SpeciesIndex < NumOldSpecies; ++SpeciesIndex)
+		{
+			const int Pair = GenomeIndex * NumOldSpecies + SpeciesIndex;
+			UGenome* Leader = OldLeaders[SpeciesIndex];
+			++QueriesPerGenome[GenomeIndex];
+
+			if (m_LeaderIndex.RulesOut(NumGenes, SpeciesIndex, Measured, Threshold))
+			{
+				PairStates[Pair] = PairRuledOut;
+				++RuledOutPerGenome[GenomeIndex];
+				continue;
+			}
+
+			int Entry = bUseCache ? m_CompatibilityCache.Find(Member->GetContentHash(), Leader->GetContentHash()) : -1;
+			if ((Entry >= 0) && m_CompatibilityCache.GetResult(Entry).Decides(Threshold))
+			{
+				PairStates[Pair] = PairFromCache;
+				PairCacheEntries[Pair] = Entry;
+				PairResults[Pair] = m_CompatibilityCache.GetResult(Entry);
+			}
+			else
 			{
-				//let the genome know which species it's in
-				genome->SetSpecies(species->GetSpeciesID());
-				species->AddMember(genome);
+				PairStates[Pair] = PairTested;
+				PairCacheEntries[Pair] = -1;
+				PairResults[Pair] = TestCompatibility(Member, GenomeIndex, Leader, m_Genomes.Num() + SpeciesIndex);
+			}
 
-				bAdded = true;
+			if (PairResults[Pair].iNumUnmatched >= 0)
+			{
+				Measured.Add(FSMeasuredLeader(SpeciesIndex, PairResults[Pair].iNumUnmatched));
+			}
 
+			if (!bNearestMatch && PairResults[Pair].IsWithin(Threshold))
+			{
 				break;
 			}
 		}
+	});
+
+	for (int i = 0; i < m_Genomes.Num(); ++i)
+	{
+		m_LeaderIndex.RecordQueries(QueriesPerGenome[i], RuledOutPerGenome[i]);
+	}
+
+	if (bUseCache)
+	{
+		int NumLookups = 0;
+		int NumHits = 0;
+
+		//touch the hits first, so the new results push out entries nobody needed this time
+		for (int Pair = 0; Pair < NumPairs; ++Pair)
+		{
+			if (PairStates[Pair] == PairFromCache)
+			{
+				m_CompatibilityCache.Touch(PairCacheEntries[Pair]);
+				++NumHits;
+				++NumLookups;
+			}
+		}
 
-		if (!bAdded)
+		for (int Pair = 0; Pair < NumPairs; ++Pair)
+		{
+			if (PairStates[Pair] == PairTested)
+			{
+				UGenome* Member = m_Genomes[Pair / NumOldSpecies];
+				UGenome* Leader = OldLeaders[Pair % NumOldSpecies];
+				m_CompatibilityCache.Add(Member->GetContentHash(), Leader->GetContentHash(), PairResults[Pair]);
+				++NumLookups;
+			}
+		}
+
+		m_CompatibilityCache.RecordLookups(NumLookups, NumHits);
+	}
+
+	//the same for pairs the table doesn't answer, on the game thread
+	auto TestOnGameThread = [&](UGenome* member, int memberSignature, UGenome* leader, int leaderSignature)
+	{
+		if (m_LeaderIndex.RulesOutByGeneCount(member->GetNumLinkGenes(), leader->GetNumLinkGenes(), Threshold))
+		{
+			m_LeaderIndex.RecordQueries(1, 1);
+			return FSCompatibilityResult(TNumericLimits<double>::Max(), false);
+		}
+		m_LeaderIndex.RecordQueries(1, 0);
+
+		if (bUseCache)
+		{
+			int Entry = m_CompatibilityCache.Find(member->GetContentHash(), leader->GetContentHash());
+			bool bHit = (Entry >= 0) && m_CompatibilityCache.GetResult(Entry).Decides(Threshold);
+			m_CompatibilityCache.RecordLookups(1, bHit ? 1 : 0);
+
+			if (bHit)
+			{
+				m_CompatibilityCache.Touch(Entry);
+				return m_CompatibilityCache.GetResult(Entry);
+			}
+		}
+
+		FSCompatibilityResult Result = TestCompatibility(member, memberSignature, leader, leaderSignature);
+		if (bUseCache)
+		{
+			m_CompatibilityCache.Add(member->GetContentHash(), leader->GetContentHash(), Result);
+		}
+		return Result;
+	};
+
+	//iterate through each genome and speciate. Sequential so the species are filled and created in the same order as always
+	for (int GenomeIndex = 0; GenomeIndex < m_Genomes.Num(); ++GenomeIndex)
+	{
+		UGenome* genome = m_Genomes[GenomeIndex];
+
+		//first compatible species, or the closest one in nearest match mode
+		USpecies* ChosenSpecies = nullptr;
+		double ChosenScore = 0.0;
+
+		//calculate its compatibility score with each species leader
+		for (int SpeciesIndex = 0; SpeciesIndex < m_Species.Num(); ++SpeciesIndex)
+		{
+			USpecies* species = m_Species[SpeciesIndex];
+			UGenome* SpeciesLeader = species->GetLeader();
+			FSCompatibilityResult Result;
+
+			//species founded during this pass or whose leader was replaced by a fitter member aren't in the table
+			const bool bInTable = (SpeciesIndex < NumOldSpecies) && (SpeciesLeader == OldLeaders[SpeciesIndex]);
+			const uint8 State = bInTable ? PairStates[GenomeIndex * NumOldSpecies + SpeciesIndex] : PairUnknown;
+
+			if (State == PairRuledOut)
+			{
+				continue;
+			}
+			else if (State != PairUnknown)
+			{
+				Result = PairResults[GenomeIndex * NumOldSpecies + SpeciesIndex];
+			}
+			else
+			{
+				//leaders that aren't in the table are members of this generation
+				const int* LeaderSignature = SignatureOfGenome.Find(SpeciesLeader);
+				Result = TestOnGameThread(genome, GenomeIndex, SpeciesLeader, LeaderSignature ? *LeaderSignature : -1);
+			}
+
+			//if this individual is similar to this species add to species
+			if (Result.IsWithin(Threshold))
+			{
+				if (!bNearestMatch)
+				{
+					ChosenSpecies = species;
+					break;
+				}
+				//ties go to the older species
+				if (!ChosenSpecies || (Result.dScore < ChosenScore))
+				{
+					ChosenSpecies = species;
+					ChosenScore = Result.dScore;
+				}
+			}
+		}
+
+		if (ChosenSpecies)
+		{
+			//let the genome know which species it's in
+			genome->SetSpecies(ChosenSpecies->GetSpeciesID());
+			ChosenSpecies->AddMember(genome);
+		}
+		else
 		{
 			//couldn't find a compatible species so create a new one
 			USpecies* NewSpecies = NewObject<USpecies>(this);
@@ -273,10 +716,17 @@ void UGeneticAlgorithm::SpeciateAndCalculateSpawnAmounts()
 			++m_iNextSpeciesID;
 			m_Species.Add(NewSpecies);
 		}
+	}
 
-		bAdded = false;
+	//members were only appended above, order them once
+	for (USpecies* species : m_Species)
+	{
+		species->FinalizeMembers();
 	}
+}
 
+void UGeneticAlgorithm::CalculateSpawnAmounts()
+{
 	//all the genomes have been assigned so adjust species fitness
 	AdjustSpeciesFitnesses();
 
@@ -306,6 +756,28 @@ void UGeneticAlgorithm::SpeciateAndCalculateSpawnAmounts()
 	}
 }
 
+void UGeneticAlgorithm::BuildSignatures(const TArray<UGenome*> &leaders)
+{
+	TArray<const FSPackedLinks*> AllLinks;
+	for (UGenome* genome : m_Genomes)
+	{
+		AllLinks.Add(&genome->GetPackedLinks());
+	}
+	for (UGenome* leader : leaders)
+	{
+		AllLinks.Add(&leader->GetPackedLinks());
+	}
+
+	//the leaders belong to the last generation and may use innovations no genome has anymore, so they are part of the table
+	m_InnovationBits.Build(AllLinks);
+
+	m_Signatures.SetNum(AllLinks.Num());
+	ParallelFor(AllLinks.Num(), [&](int32 Index)
+	{
+		m_InnovationBits.CreateSignature(*AllLinks[Index], m_Signatures[Index]);
+	});
+}
+
 void UGeneticAlgorithm::ResetAndKill()
 {
 	m_dTotalAdjustedFitness = 0.0;
@@ -381,7 +853,7 @@ void UGeneticAlgorithm::AdjustSpeciesFitnesses()
 	}
 }
 
-UGenome* UGeneticAlgorithm::Crossover(UGenome* motherGenome, UGenome* fatherGenome)
+void UGeneticAlgorithm::Crossover(UGenome* motherGenome, UGenome* fatherGenome, UGenome* babyGenome, FSCrossoverScratch &scratch, FRandomStream &rng)
 {
 	UGenome* FitterParent = nullptr;
 	UGenome* OtherParent = nullptr;
@@ -397,7 +869,7 @@ UGenome* UGeneticAlgorithm::Crossover(UGenome* motherGenome, UGenome* fatherGeno
 		if (MotherSize == FatherSize)
 		{
 			//choose random
-			if (RandFloat() < 0.5f)
+			if (RandFloat(rng) < 0.5f)
 			{
 				FitterParent = motherGenome;
 				OtherParent = fatherGenome;
@@ -437,121 +909,189 @@ UGenome* UGeneticAlgorithm::Crossover(UGenome* motherGenome, UGenome* fatherGeno
 		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("GeneticAlgorithm Crossover error parent fitness"));
 	}
 
-	TArray<FSNeuronGene> BabyNeurons;
-	TArray<int> NecessaryNeuronIDs;
+	//only genes at the positions of the fitter parent are inherited, so the child is never bigger than it
+	FSGeneStorage &BabyGenes = babyGenome->InitializeEmpty(-1, FitterParent->GetNumNeuronGenes(), FitterParent->GetNumLinkGenes(),
+		motherGenome->GetNumInputs(), motherGenome->GetNumOutputs(), m_GameMode);
 
-	TArray<FSLinkGene> BabyLinkGenes;
+	CrossoverGenes(*FitterParent, *OtherParent, scratch, rng, BabyGenes);
+}
 
-	//iterators for the current link genes
-	TArray<FSLinkGene> FitParentLinks = FitterParent->GetLinkGenesList();
-	TArray<FSLinkGene> OtherParentLinks = OtherParent->GetLinkGenesList();
-	TArray<FSLinkGene>::TIterator CurrentFitterGene = FitParentLinks.CreateIterator();
-	TArray<FSLinkGene>::TIterator CurrentOtherGene = OtherParentLinks.CreateIterator();
+void UGeneticAlgorithm::CrossoverGenes(const UGenome &fitterParent, const UGenome &otherParent, FSCrossoverScratch &scratch, FRandomStream &rng, FSGeneStorage &babyGenes)
+{
+	const TArray<FSLinkGene> &FitterLinks = fitterParent.GetLinkGenesList();
+	const TArray<FSLinkGene> &OtherLinks = otherParent.GetLinkGenesList();
+	const int NumFitterLinks = FitterLinks.Num();
+	const int NumOtherLinks = OtherLinks.Num();
 
-	FSLinkGene SelectedLinkGene;
+	scratch.Begin(fitterParent.GetNeuronGenesList(), otherParent.GetNeuronGenesList());
 
-	//if we should push the gene
-	bool bPushGene = true;
+	//positions of the current link genes
+	int CurrentFitterGene = 0;
+	int CurrentOtherGene = 0;
 
-	//select genes until we are done with both genomes
-	while (CurrentFitterGene || CurrentOtherGene)
+	//select genes until we are done with the fitter genome, excess genes of the worse one are never used
+	while (CurrentFitterGene < NumFitterLinks)
 	{
+		const FSLinkGene* SelectedLinkGene = nullptr;
+
 		//reached the end of the worse genome, just add excess gene from the fitter one
-		if (!CurrentOtherGene)
+		if (CurrentOtherGene >= NumOtherLinks)
 		{
-			SelectedLinkGene = *CurrentFitterGene;
+			SelectedLinkGene = &FitterLinks[CurrentFitterGene];
 			++CurrentFitterGene;
-			bPushGene = true;
-		}
-		//reached end of fitter genome, just increment the worse one until both ends are reached
-		else if (!CurrentFitterGene)
-		{
-			++CurrentOtherGene;
-			bPushGene = false;
 		}
 		//both IDs are the same
-		else if (CurrentFitterGene->iInnovationID == CurrentOtherGene->iInnovationID)
+		else if (FitterLinks[CurrentFitterGene].iInnovationID == OtherLinks[CurrentOtherGene].iInnovationID)
 		{
 			//select randomly
-			if (RandFloat() < 0.5)
+			if (RandFloat(rng) < 0.5)
 			{
-				SelectedLinkGene = *CurrentFitterGene;
+				SelectedLinkGene = &FitterLinks[CurrentFitterGene];
 			}
 			else
 			{
-				SelectedLinkGene = *CurrentOtherGene;
+				SelectedLinkGene = &OtherLinks[CurrentOtherGene];
 			}
 
 			++CurrentFitterGene;
 			++CurrentOtherGene;
-			bPushGene = true;
 		}
 		//fitter ID is smaller so we can select
-		else if (CurrentFitterGene->iInnovationID < CurrentOtherGene->iInnovationID)
+		else if (FitterLinks[CurrentFitterGene].iInnovationID < OtherLinks[CurrentOtherGene].iInnovationID)
 		{
-			SelectedLinkGene = *CurrentFitterGene;
+			SelectedLinkGene = &FitterLinks[CurrentFitterGene];
 			++CurrentFitterGene;
-			bPushGene = true;
 		}
 		//fitter ID is bigger, we musn't push it yet, because it could be a matching gene
-		else if (CurrentFitterGene->iInnovationID > CurrentOtherGene->iInnovationID)
+		else
 		{
 			++CurrentOtherGene;
-			bPushGene = false;
+			continue;
 		}
 
 		//add the selected link gene
-		if (bPushGene)
+		babyGenes.Links.Add(*SelectedLinkGene);
+		FSLinkGene &BabyLink = babyGenes.Links.Last();
+
+		if (BabyLink.bEnabled == false)
 		{
-			if (SelectedLinkGene.bEnabled == false)
+			//75% chance for the gene to stay disabled
+			if (RandFloat(rng) < 0.25f)
 			{
-				//75% chance for the gene to stay disabled
-				if (RandFloat() < 0.25f)
-				{
-					SelectedLinkGene.bEnabled = true;
-				}
+				BabyLink.bEnabled = true;
 			}
-			BabyLinkGenes.Add(SelectedLinkGene);
 		}
 
-		//add neurons of the used link if they aren't already registered
-		AddNeuronID(SelectedLinkGene.FromNeuron, NecessaryNeuronIDs);
-		AddNeuronID(SelectedLinkGene.ToNeuron, NecessaryNeuronIDs);
-	}//end while
+		//the neurons of the used link are needed by the child
+		scratch.UseNeuron(BabyLink.FromNeuron);
+		scratch.UseNeuron(BabyLink.ToNeuron);
+	}
 
-	NecessaryNeuronIDs.Sort();
+	scratch.EmitNeurons(babyGenes.Neurons);
+}
 
-	for (int32 ID : NecessaryNeuronIDs)
+void FSCrossoverScratch::Begin(const TArray<FSNeuronGene> &fitterNeurons, const TArray<FSNeuronGene> &otherNeurons)
+{
+	++CurrentStamp;
+
+	//stamps wrapped around, old ones could look current again
+	if (CurrentStamp == 0)
 	{
-		BabyNeurons.Add(m_Innovation->CreateNeuronFromID(ID));
+		FMemory::Memzero(NeuronStamps.GetData(), NeuronStamps.Num() * sizeof(uint32));
+		CurrentStamp = 1;
 	}
 
-	UGenome* BabyGenome = NewObject<UGenome>();
-	BabyGenome->InitializeCustom(-1, BabyNeurons, BabyLinkGenes, motherGenome->GetNumInputs(), motherGenome->GetNumOutputs(), m_GameMode);
+	MinNeuronID = MAX_int32;
+	MaxNeuronID = -1;
+
+	//both parents store the same gene for a neuron ID, so it doesn't matter which one is registered last
+	AddSources(otherNeurons);
+	AddSources(fitterNeurons);
+}
 
-	return BabyGenome;
+void FSCrossoverScratch::AddSources(const TArray<FSNeuronGene> &neurons)
+{
+	for (const FSNeuronGene &curNeuron : neurons)
+	{
+		if (curNeuron.iID >= NeuronSources.Num())
+		{
+			//grow with some headroom, new neurons are added every generation
+			int NewSize = curNeuron.iID + 1 + curNeuron.iID / 2;
+			NeuronSources.SetNumZeroed(NewSize);
+			NeuronStamps.SetNumZeroed(NewSize);
+		}
+		NeuronSources[curNeuron.iID] = &curNeuron;
+	}
 }
 
-UGenome* UGeneticAlgorithm::TournamentSelection(int numTries)
+void FSCrossoverScratch::UseNeuron(int neuronID)
 {
-	double BestFitnessSoFar = 0;
+	if (NeuronStamps[neuronID] == CurrentStamp)
+	{
+		return;
+	}
 
-	int ChosenGenomeID = 0;
+	NeuronStamps[neuronID] = CurrentStamp;
+	MinNeuronID = FMath::Min(MinNeuronID, neuronID);
+	MaxNeuronID = FMath::Max(MaxNeuronID, neuronID);
+}
 
-	//select NumComparisons members from the population at random testing against the best found so far
-	for (int i = 0; i < numTries; ++i)
+void FSCrossoverScratch::EmitNeurons(TArray<FSNeuronGene> &outNeurons) const
+{
+	//walking the IDs in order keeps the neurons sorted without sorting them
+	for (int ID = MinNeuronID; ID <= MaxNeuronID; ++ID)
 	{
-		int ThisTry = RandInt(0, m_Genomes.Num() - 1);
+		if (NeuronStamps[ID] == CurrentStamp)
+		{
+			outNeurons.Add(*NeuronSources[ID]);
+		}
+	}
+}
 
-		if (m_Genomes[ThisTry]->GetFitness() > BestFitnessSoFar)
+UGenome* UGeneticAlgorithm::TournamentSelection(FRandomStream &rng)
+{
+	return m_Genomes[m_TournamentTable.Sample(rng)];
+}
+
+void UGeneticAlgorithm::BuildTournamentTable(int numTries)
+{
+	//a tournament probes numTries random members and keeps the fittest one with a fitness above zero, or the first
+	//genome if there is none. On a population sorted by fitness the winner is the best probed rank, so rank i wins
+	//with (n - i)^k - (n - i - 1)^k out of n^k. Members with equal fitness share the odds of their group evenly
+	int Count = m_Genomes.Num();
+	m_TournamentWeights.Reset();
+	m_TournamentWeights.SetNumZeroed(Count);
+
+	int GroupStart = 0;
+	while (GroupStart < Count)
+	{
+		double GroupFitness = m_Genomes[GroupStart]->GetFitness();
+		int GroupEnd = GroupStart + 1;
+		while (GroupEnd < Count && m_Genomes[GroupEnd]->GetFitness() == GroupFitness)
 		{
-			ChosenGenomeID = ThisTry;
+			++GroupEnd;
+		}
+
+		//chance that the best probed rank lies within the group
+		double GroupOdds = FMath::Pow((double)(Count - GroupStart) / Count, numTries) - FMath::Pow((double)(Count - GroupEnd) / Count, numTries);
 
-			BestFitnessSoFar = m_Genomes[ThisTry]->GetFitness();
+		if (GroupFitness > 0)
+		{
+			for (int i = GroupStart; i < GroupEnd; ++i)
+			{
+				m_TournamentWeights[i] = GroupOdds / (GroupEnd - GroupStart);
+			}
+		}
+		//nothing better than zero was probed
+		else
+		{
+			m_TournamentWeights[0] += GroupOdds;
 		}
+
+		GroupStart = GroupEnd;
 	}
 
-	return m_Genomes[ChosenGenomeID];
+	m_TournamentTable.Build(m_TournamentWeights);
 }
 
 void UGeneticAlgorithm::SortAndRecord()
@@ -563,7 +1103,7 @@ void UGeneticAlgorithm::SortAndRecord()
 	if (m_Genomes[0]->GetFitness() >= m_dBestFitnessEver)
 	{
 		m_dBestFitnessEver = m_Genomes[0]->GetFitness();
-		m_BestGenomeEver = NewObject<UGenome>(this, UGenome::StaticClass(), NAME_None, RF_NoFlags, m_Genomes[0]);
+		m_BestGenomeEver = m_Genomes[0]->CreateCopy(this);
 	}
 
 	//keep a record of the n best genomes
@@ -575,9 +1115,13 @@ void UGeneticAlgorithm::StoreBestGenomes()
 	//clear old record
 	m_BestGenomes.Empty();
 
+	//in steady state mode the population stays in slot order, so rank a copy
+	TArray<UGenome*> Ranked = m_Genomes;
+	Ranked.StableSort();
+
 	for (int i = 0; i < m_Parameters->iNumBestOrganisms; ++i)
 	{
-		m_BestGenomes.Add(m_Genomes[i]);
+		m_BestGenomes.Add(Ranked[i]);
 	}
 }
 
@@ -588,7 +1132,7 @@ TArray<UNeuralNet*> UGeneticAlgorithm::GetLastGenerationsBestPhenotypes()
 	for (UGenome* curGenome : m_BestGenomes)
 	{
 		curGenome->CalculateNetDepth(m_FSplitDepths);
-		BestPhenotypes.Add(curGenome->CreatePhenotype());
+		BestPhenotypes.Add(curGenome->CreatePhenotype(&m_Arenas[m_iCurrentArena]));
 	}
 	return BestPhenotypes;
 }
@@ -596,7 +1140,7 @@ TArray<UNeuralNet*> UGeneticAlgorithm::GetLastGenerationsBestPhenotypes()
 UNeuralNet* UGeneticAlgorithm::GetBestPhenotype()
 {
 	m_BestGenomeEver->CalculateNetDepth(m_FSplitDepths);
-	UNeuralNet* BestPhenotype = m_BestGenomeEver->CreatePhenotype();
+	UNeuralNet* BestPhenotype = m_BestGenomeEver->CreatePhenotype(&m_Arenas[m_iCurrentArena]);
 
 	return BestPhenotype;
 }
@@ -606,24 +1150,211 @@ void UGeneticAlgorithm::SetFitness(int genome, double fitness)
 	m_Genomes[genome]->SetFitness(fitness);
 }
 
-bool UGeneticAlgorithm::AddNeuronID(int neuronID, TArray<int> &vNeurons)
+int UGeneticAlgorithm::ReportEvaluation(int genome, double fitness, UNeuralNet* &outNet)
 {
-	bool bFoundID = false;
+	UGenome* Evaluated = m_Genomes[genome];
+	int &NumEvaluations = m_EvaluationCounts[genome];
+
+	//a genome that is played again keeps the mean of all its runs
+	Evaluated->SetFitness((Evaluated->GetFitness() * NumEvaluations + fitness) / (NumEvaluations + 1));
+	++NumEvaluations;
 
-	for (int i = 0; i < vNeurons.Num(); ++i)
+	//genomes only join a species once their fitness is known
+	if (NumEvaluations == 1)
+	{
+		AssignToSpecies(Evaluated);
+	}
+	else
 	{
-		if (vNeurons[i] == neuronID)
+		USpecies** Species = m_Species.FindByPredicate([&](USpecies* species) { return species->GetSpeciesID() == Evaluated->GetSpecies(); });
+		if (Species)
 		{
-			bFoundID = true;
-			return true;
+			(*Species)->UpdateLeader(Evaluated);
 		}
 	}
 
-	if (!bFoundID)
+	if (Evaluated->GetFitness() >= m_dBestFitnessEver)
 	{
-		vNeurons.Add(neuronID);
+		m_dBestFitnessEver = Evaluated->GetFitness();
+		m_BestGenomeEver = Evaluated->CreateCopy(this);
 	}
-	return false;
+
+	++m_iEvaluationsSinceReplacement;
+	if (m_iEvaluationsSinceReplacement < FMath::Max(m_Parameters->iSteadyStateInterval, 1))
+	{
+		return -1;
+	}
+	m_iEvaluationsSinceReplacement = 0;
+
+	return ReplaceWorst(outNet);
+}
+
+int UGeneticAlgorithm::ReplaceWorst(UNeuralNet* &outNet)
+{
+	//the worst genome by fitness shared with its species. Only genomes that were played are judged
+	int WorstIndex = -1;
+	double WorstAdjustedFitness = TNumericLimits<double>::Max();
+	USpecies* WorstSpecies = nullptr;
+
+	for (int i = 0; i < m_Genomes.Num(); ++i)
+	{
+		if (m_EvaluationCounts[i] == 0)
+		{
+			continue;
+		}
+
+		USpecies** Species = m_Species.FindByPredicate([&](USpecies* species) { return species->GetSpeciesID() == m_Genomes[i]->GetSpecies(); });
+		if (!Species)
+		{
+			continue;
+		}
+
+		double AdjustedFitness = m_Genomes[i]->GetFitness() / (*Species)->GetNumMembers();
+		if (AdjustedFitness < WorstAdjustedFitness)
+		{
+			WorstAdjustedFitness = AdjustedFitness;
+			WorstIndex = i;
+			WorstSpecies = *Species;
+		}
+	}
+
+	//need at least one other evaluated genome to breed from
+	if ((WorstIndex < 0) || ((m_Species.Num() == 1) && (WorstSpecies->GetNumMembers() == 1)))
+	{
+		return -1;
+	}
+
+	WorstSpecies->RemoveMember(m_Genomes[WorstIndex]);
+	if (WorstSpecies->GetNumMembers() == 0)
+	{
+		m_Species.Remove(WorstSpecies);
+	}
+
+	FRandomStream Rng = CreateRandomStream(SteadyStateStream, 0);
+
+	//parent species drawn by the average fitness of its members
+	m_SpeciesWeights.Reset();
+	for (USpecies* species : m_Species)
+	{
+		m_SpeciesWeights.Add(species->GetAverageFitness());
+	}
+	m_SpeciesTable.Build(m_SpeciesWeights);
+
+	FSOffspringTask Task;
+	Task.Species = m_Species[m_SpeciesTable.Sample(Rng)];
+	Task.Species->FinalizeMembers();
+
+	if (m_CrossoverScratches.Num() == 0)
+	{
+		m_CrossoverScratches.SetNum(1);
+	}
+
+	//a species of one can only hand out a copy, the child is mutated anyway so the slot isn't spent on a duplicate
+	UGenome* Child = NewObject<UGenome>(this);
+	BreedChild(Task, Child, m_CrossoverScratches[0], Rng);
+	TArray<UGenome*> Children;
+	Children.Add(Child);
+	MutateChildren(Children);
+	Child->SetID(m_iNextGenomeID);
+	++m_iNextGenomeID;
+	Child->SetFitness(0.0);
+
+	m_dCrossoverSecondsLastGen += Task.CrossoverSeconds;
+	m_iCrossoversLastGen += Task.NumCrossovers;
+
+	//the child takes over the slot and is played when its turn comes
+	m_Genomes[WorstIndex] = Child;
+	m_EvaluationCounts[WorstIndex] = 0;
+	++m_iReplacements;
+
+	//the population's nets own their memory in steady state mode, the arenas only hold the nets of the best ships
+	Child->CalculateNetDepth(m_FSplitDepths);
+	outNet = Child->CreatePhenotype();
+
+	return WorstIndex;
+}
+
+void UGeneticAlgorithm::AssignToSpecies(UGenome* genome)
+{
+	const FSCompatibilityCoefficients Coefficients(m_Parameters);
+	const double Threshold = m_Parameters->dCompatibilityThreshold;
+
+	USpecies* ChosenSpecies = nullptr;
+	double ChosenScore = 0.0;
+
+	genome->PackLinks();
+
+	for (USpecies* species : m_Species)
+	{
+		species->GetLeader()->PackLinks();
+		FSCompatibilityResult Result = FCompatibility::TestThreshold(genome->GetPackedLinks(), species->GetLeader()->GetPackedLinks(), Coefficients, Threshold);
+
+		if (Result.IsWithin(Threshold))
+		{
+			if (!m_Parameters->bNearestSpeciesMatch)
+			{
+				ChosenSpecies = species;
+				break;
+			}
+			//ties go to the older species
+			if (!ChosenSpecies || (Result.dScore < ChosenScore))
+			{
+				ChosenSpecies = species;
+				ChosenScore = Result.dScore;
+			}
+		}
+	}
+
+	if (ChosenSpecies)
+	{
+		ChosenSpecies->AddMember(genome);
+	}
+	else
+	{
+		USpecies* NewSpecies = NewObject<USpecies>(this);
+		NewSpecies->Initialize(genome, m_iNextSpeciesID, m_GameMode);
+		genome->SetSpecies(m_iNextSpeciesID);
+		++m_iNextSpeciesID;
+		m_Species.Add(NewSpecies);
+	}
+}
+
+void UGeneticAlgorithm::ImportMigrant(int slot, const UGenome* migrant, const UInnovation &sourceInnovations)
+{
+	UGenome* Immigrant = NewObject<UGenome>(this);
+	Immigrant->CopyFrom(migrant);
+
+	//detaches the genes from the emigrant and rewrites them
+	m_Innovation->ImportGenome(Immigrant, sourceInnovations);
+
+	Immigrant->SetID(m_iNextGenomeID);
+	++m_iNextGenomeID;
+
+	m_Genomes[slot] = Immigrant;
+}
+
+void UGeneticAlgorithm::EndSteadyStateRound()
+{
+	m_AvgNumLinksLastGen = 0.0;
+	m_AvgNumNeuronsLastGen = 0.0;
+	for (UGenome* curGenome : m_Genomes)
+	{
+		m_AvgNumLinksLastGen += curGenome->GetNumLinkGenes();
+		m_AvgNumNeuronsLastGen += curGenome->GetNumNeuronGenes();
+	}
+	m_AvgNumLinksLastGen /= m_Genomes.Num();
+	m_AvgNumNeuronsLastGen /= m_Genomes.Num();
+
+	StoreBestGenomes();
+
+	//the best ships get their nets out of the arena, the ones from the round before last aren't used anymore
+	SwapArenas();
+
+	//the threshold only affects genomes that are assigned from now on
+	AdjustCompatibilityThreshold();
+
+	m_iGeneAllocationsLastGen = UGenome::ConsumeGeneStorageAllocations();
+	++m_iGeneration;
 }
 
 TArray<FSplitDepth> UGeneticAlgorithm::Split(double low, double high, int depth)
@@ -631,6 +1362,12 @@ TArray<FSplitDepth> UGeneticAlgorithm::Split(double low, double high, int depth)
 	static TArray<FSplitDepth> vSplits;
 	double span = high - low;
 
+	//every population builds its own table, the static list only collects the recursion
+	if (depth == 0)
+	{
+		vSplits.Reset();
+	}
+
 	vSplits.Add(FSplitDepth(low + span / 2, depth + 1));
 
 	//calculates the SlitY-values to a depth of 6 hidden layers so to calc the net depth
@@ -656,6 +1393,33 @@ FString UGeneticAlgorithm::GetGenomeStats()
 	m_AvgNumLinksLastGen = 0.0;
 	m_AvgNumNeuronsLastGen = 0.0;
 
-	FString stats = FString::SanitizeFloat(AvgNumLinks) + ";" + FString::SanitizeFloat(AvgNumNeurons);
+	FString stats = FString::SanitizeFloat(AvgNumLinks) + ";" + FString::SanitizeFloat(AvgNumNeurons) + ";" + FString::FromInt(int(GetArenaPeakBytes() / 1024))
+		+ ";" + FString::FromInt(m_iGeneAllocationsLastGen) + ";" + FString::SanitizeFloat(GetCrossoversPerMs())
+		+ ";" + FString::SanitizeFloat(m_CompatibilityCache.ConsumeHitRate()) + ";" + FString::SanitizeFloat(m_LeaderIndex.ConsumeRuledOutRate());
+
+	m_dCrossoverSecondsLastGen = 0.0;
+	m_iCrossoversLastGen = 0;
+
 	return stats;
-}
\ No newline at end of file
+}
+
+void UGeneticAlgorithm::SwapArenas()
+{
+	//everything in the other arena belongs to the generation before last. The ships got new nets since then
+	m_iCurrentArena = 1 - m_iCurrentArena;
+	m_Arenas[m_iCurrentArena].Reset();
+}
+
+SIZE_T UGeneticAlgorithm::GetArenaPeakBytes() const
+{
+	return m_Arenas[0].GetPeakBytes() + m_Arenas[1].GetPeakBytes();
+}
+
+double UGeneticAlgorithm::GetCrossoversPerMs() const
+{
+	if (m_dCrossoverSecondsLastGen <= 0.0)
+	{
+		return 0.0;
+	}
+	return m_iCrossoversLastGen / (m_dCrossoverSecondsLastGen * 1000.0);
+}
@@ -17,6 +17,11 @@
 
 
 #include "Globals.h"
+#include "GenerationArena.h"
+#include "Compatibility.h"
+#include "CompatibilityCache.h"
+#include "SpeciesLeaderIndex.h"
+#include "AliasTable.h"
 
 #include "CoreMinimal.h"
 #include "GameFramework/Info.h"
@@ -29,6 +34,59 @@ class UInnovation;
 class UNeuralNet;
 class AMyGameMode;
 class UParameters;
+struct FSNeuronGene;
+struct FSGeneStorage;
+
+
+//Reusable memory of the crossover kernel. Neuron membership is tracked by stamping neuron IDs with the number of the
+//current crossover, so nothing has to be cleared between children
+struct FSCrossoverScratch
+{
+	//crossover number each neuron ID was last used in
+	TArray<uint32> NeuronStamps;
+	//neuron gene of each ID in the current parents
+	TArray<const FSNeuronGene*> NeuronSources;
+	uint32 CurrentStamp;
+
+	//range of the neuron IDs used by the current child
+	int MinNeuronID;
+	int MaxNeuronID;
+
+	FSCrossoverScratch() : CurrentStamp(0), MinNeuronID(0), MaxNeuronID(-1) {}
+
+	//Starts a new child and registers the neuron genes of both parents
+	void Begin(const TArray<FSNeuronGene> &fitterNeurons, const TArray<FSNeuronGene> &otherNeurons);
+
+	//Marks the neuron as needed by the child
+	void UseNeuron(int neuronID);
+
+	//Appends the needed neurons in ascending ID order
+	void EmitNeurons(TArray<FSNeuronGene> &outNeurons) const;
+
+private:
+	void AddSources(const TArray<FSNeuronGene> &neurons);
+};
+
+
+//The share of the next generation one species produces. Its children are a contiguous range of the next generation
+//and use a contiguous range of IDs, so species can reproduce in parallel with the same result as one after the other
+struct FSOffspringTask
+{
+	USpecies* Species;
+
+	//first index in the next generation and number of children
+	int FirstChild;
+	int NumChildren;
+
+	//ID of the first child that isn't the leader copy
+	int FirstID;
+
+	//time spent in the crossover kernel and number of crossovers
+	double CrossoverSeconds;
+	int NumCrossovers;
+
+	FSOffspringTask() : Species(nullptr), FirstChild(0), NumChildren(0), FirstID(0), CrossoverSeconds(0.0), NumCrossovers(0) {}
+};
 
 
 //The main class for the NEAT-Genetic Algorithm
@@ -58,6 +116,8 @@ private:
 
 	//current generation
 	int m_iGeneration;
+	//index in the island model, part of the random seed so islands don't evolve in lockstep
+	int m_iIsland;
 	int m_iNextGenomeID;
 	int m_iNextSpeciesID;
 	int m_iPopSize;
@@ -86,29 +146,157 @@ private:
 	double m_AvgNumNeuronsLastGen;
 	double m_AvgNumLinksLastGen;
 
+	//number of gene storages allocated during the last epoch. Unmutated children share the genes of their parent
+	int m_iGeneAllocationsLastGen;
+
+	//crossover memory of the species that reproduce in parallel, one per species
+	TArray<FSCrossoverScratch> m_CrossoverScratches;
+
+	//salts the random streams so that different stages never draw the same numbers for the same index
+	enum EStreamPurpose
+	{
+		ReproductionStream = 1,
+		MutationStream,
+		SelectionStream,
+		SteadyStateStream
+	};
+
+	//odds of each rank of the sorted population to win a tournament
+	FAliasTable m_TournamentTable;
+	TArray<double> m_TournamentWeights;
+
+	//innovation bits and signatures of the last speciation, kept to reuse their memory
+	FInnovationBitTable m_InnovationBits;
+	TArray<FSLinkSignature> m_Signatures;
+
+	//compatibility results of genome contents that were compared in earlier generations
+	FCompatibilityCache m_CompatibilityCache;
+
+	//lower bounds on the distances to the species leaders of the last generation
+	FSpeciesLeaderIndex m_LeaderIndex;
+
+	//what speciation knows about a genome and an old leader
+	enum EPairState : uint8
+	{
+		PairUnknown,
+		PairRuledOut,
+		PairFromCache,
+		PairTested
+	};
+
+	//steady state mode: evaluations of the genome in each slot, evaluations until the next replacement is due
+	//and the number of replacements so far
+	TArray<int> m_EvaluationCounts;
+	int m_iEvaluationsSinceReplacement;
+	int m_iReplacements;
+
+	//odds of each species to breed the next steady state offspring
+	FAliasTable m_SpeciesTable;
+	TArray<double> m_SpeciesWeights;
+
+	//steps of an epoch, in order. StepEpoch works through them and can stop between two pieces of work
+	enum EEpochPhase
+	{
+		EpochIdle,
+		EpochSort,
+		EpochSpeciate,
+		EpochSpawnAmounts,
+		EpochReproduce,
+		EpochMutate,
+		EpochCompile,
+		EpochDone
+	};
+	EEpochPhase m_EpochPhase;
+
+	//what an epoch in progress works on between two steps
+	TArray<double> m_EpochFitness;
+	TArray<FSOffspringTask> m_OffspringTasks;
+	int m_iNextOffspringTask;
+	TArray<bool> m_OffspringMutated;
+
+	UPROPERTY()
+		//children of the species in species order, created before the species fill them in
+		TArray<UGenome*> m_OffspringChildren;
+	UPROPERTY()
+		//the next generation while it is built and the children in it that get mutated
+		TArray<UGenome*> m_NextGeneration;
+	UPROPERTY()
+		TArray<UGenome*> m_MutatedChildren;
+	UPROPERTY()
+		//nets of the next generation compiled so far
+		TArray<UNeuralNet*> m_NewNetworks;
+
+	//time spent in the crossover kernel and number of children it produced during the last epoch
+	double m_dCrossoverSecondsLastGen;
+	int m_iCrossoversLastGen;
+
+	//double buffered memory for the compiled networks. The nets of the generation that just played stay valid
+	//while the next generation is compiled into the other arena
+	FGenerationArena m_Arenas[2];
+	int m_iCurrentArena;
 
 
-	//Checks if the passed list already contains the neuron
-	bool AddNeuronID(int neuronID, TArray<int> &vNeurons);
 
 	//Resets some values to ready for the next epoch, kills off all the phenotypes and any poorly performing species
 	void ResetAndKill();
 
 	//Separates each individual into its respective species by calculating
 	//a compatibility score with every other member of the population and 
-	//niching accordingly. The function then adjusts the fitness scores of
-	//each individual by species age and by sharing and also determines
-	//how many offspring each individual should spawn
-	void SpeciateAndCalculateSpawnAmounts();
+	//niching accordingly
+	void Speciate();
+
+	//Adjusts the fitness scores of each individual by species age and by sharing
+	//and determines how many offspring each individual and species should spawn
+	void CalculateSpawnAmounts();
+
+	//Creates the signatures of all genomes followed by the ones of the passed leaders
+	void BuildSignatures(const TArray<UGenome*> &leaders);
 
 	//Adjusts the fitness scores depending on the number sharing the species and the age of the species
 	void AdjustSpeciesFitnesses();
 
-	//Generate offspring out of two genomes
-	UGenome* Crossover(UGenome* motherGenome, UGenome* fatherGenome);
+	//Generate offspring out of two genomes into babyGenome
+	void Crossover(UGenome* motherGenome, UGenome* fatherGenome, UGenome* babyGenome, FSCrossoverScratch &scratch, FRandomStream &rng);
+
+	//Decides how many children each species gets and creates them empty
+	void PrepareOffspring();
+
+	//Lets the species of the given tasks fill in their children in parallel
+	void ProduceOffspringBatch(int firstTask, int numTasks);
+
+	//Adds the children to the next generation in species order
+	void MergeOffspring();
+
+	//Tops up the next generation with tournament winners if the species spawned too few children
+	void FillPopulation();
+
+	//Fills the children of one species. Runs on a worker, the genomes were created beforehand
+	void ProduceOffspring(FSOffspringTask &task, const TArray<UGenome*> &children, TArray<bool> &mutated, FSCrossoverScratch &scratch);
+
+	//Breeds one child of the task's species that isn't its leader. Returns true if the child needs to be mutated
+	bool BreedChild(FSOffspringTask &task, UGenome* child, FSCrossoverScratch &scratch, FRandomStream &rng);
+
+	//Replaces the evaluated genome with the lowest shared fitness by an offspring of a species drawn by average fitness.
+	//Returns the replaced slot and the child's net, or -1 if there is nothing to breed from yet
+	int ReplaceWorst(UNeuralNet* &outNet);
+
+	//Puts the genome into the first compatible species (or the closest one) or creates a new one for it
+	void AssignToSpecies(UGenome* genome);
+
+	//Returns a stream seeded by the random seed, the generation, the purpose and the index
+	FRandomStream CreateRandomStream(int purpose, int index) const;
+
+	//Runs the mutation operators on all children in parallel and resolves their structural mutations afterwards
+	void MutateChildren(const TArray<UGenome*> &children);
+
+	//Writes the genes of the child of the two parents into babyGenes. Only reads the parents
+	static void CrossoverGenes(const UGenome &fitterParent, const UGenome &otherParent, FSCrossoverScratch &scratch, FRandomStream &rng, FSGeneStorage &babyGenes);
 
 	//Test fitness of genomes from the entire population against each other numTries, select the winner
-	UGenome* TournamentSelection(int numTries);
+	UGenome* TournamentSelection(FRandomStream &rng);
+
+	//Precomputes the tournament odds of the population, which has to be sorted by fitness
+	void BuildTournamentTable(int numTries);
 
 	//Sorts the population into descending fitness, keeps a record of the best genomes and updates any fitness statistics accordingly
 	void SortAndRecord();
@@ -119,6 +307,9 @@ private:
 	//Used to calculate a lookup table of split depths
 	TArray<FSplitDepth> Split(double low, double high, int depth);
 
+	//Switches to the other arena and frees the nets of the generation before last stored in it
+	void SwapArenas();
+
 public:
 	UGeneticAlgorithm();
 	//Creates a population starting with minimal, fully connected genomes consisting of specified number of inputs and outputs
@@ -127,6 +318,13 @@ public:
 	//Main update function of the GeneticAlgorithm module. Creates new generation
 	TArray<UNeuralNet*> Epoch(TArray<double> &fitnessScores);
 
+	//Epoch split over several frames. BeginEpoch takes the scores, StepEpoch is called every frame until it returns true
+	//and FinishEpoch returns the nets of the new generation. budgetSeconds of 0 finishes the epoch in one call
+	void BeginEpoch(const TArray<double> &fitnessScores);
+	bool StepEpoch(double budgetSeconds);
+	TArray<UNeuralNet*> FinishEpoch();
+	bool IsEpochRunning() const { return m_EpochPhase != EpochIdle; }
+
 	//Creates pointer to the genotypes of the population
 	TArray<UGenome*> GetGenotypes();
 
@@ -139,13 +337,33 @@ public:
 	//Returns the best phenotype ever found
 	UNeuralNet* GetBestPhenotype();
 
+	//Steady state (rtNEAT) mode, used instead of Epoch. Records one finished run of the genome in the given slot and
+	//replaces the worst genome after every iSteadyStateInterval runs. Returns the replaced slot and its new net, or -1
+	int ReportEvaluation(int genome, double fitness, UNeuralNet* &outNet);
+
+	//Steady state mode has no generations. After every population size runs this updates the stats and best genomes
+	//a generation would have and advances the generation counter
+	void EndSteadyStateRound();
+
 	FString GetGenomeStats();
 
+	//Puts a copy of a genome from another island into the slot, translated to this island's innovations
+	void ImportMigrant(int slot, const UGenome* migrant, const UInnovation &sourceInnovations);
+	void SetIsland(int island) { m_iIsland = island; }
+
+	//Memory used by both arenas at their peak this generation
+	SIZE_T GetArenaPeakBytes() const;
+
+	//Crossover throughput of the last epoch
+	double GetCrossoversPerMs() const;
+
 
 
 	int GetNumSpecies()const { return m_Species.Num(); }
 	double GetBestEverFitness()const { return m_dBestFitnessEver; }
 	int GetGeneration()const { return m_iGeneration; }
+	const UInnovation* GetInnovation()const { return m_Innovation; }
+	UGenome* GetGenome(int index) { return m_Genomes[index]; }
 	TArray<FSplitDepth> GetFSplitDepthLookupTable() { return m_FSplitDepths; }
 
 	void SetFitness(int genome, double fitness);
@@ -22,6 +22,8 @@
 
 
 
+FThreadSafeCounter UGenome::s_GeneStorageAllocations;
+
 UGenome::UGenome()
 {
 	m_Phenotype = nullptr;
@@ -31,6 +33,7 @@ UGenome::UGenome()
 	m_iNumInputs = 0;
 	m_iNumOutputs = 0;
 	m_dSpawnAmount = 0;
+	m_iNextProvisionalID = -2;
 }
 
 void UGenome::InitializeStandard(int id, int numInputs, int numOutputs, AMyGameMode* gameMode)
@@ -43,28 +46,34 @@ void UGenome::InitializeStandard(int id, int numInputs, int numOutputs, AMyGameM
 	m_iNumOutputs = numOutputs;
 	m_dSpawnAmount = 0;
 
+	m_Genes = MakeShared<FSGeneStorage, ESPMode::ThreadSafe>();
+	s_GeneStorageAllocations.Increment();
+	TArray<FSNeuronGene> &NewNeurons = m_Genes->Neurons;
+	TArray<FSLinkGene> &NewLinks = m_Genes->Links;
+
 	//determine grid size
 	double InputRowSlice = 0.8 / double(numInputs);
 
 	//create the input neurons with IDs from 0 to numInputs
 	for (int i = 0; i < m_iNumInputs; i++)
 	{
-		m_Neurons.Add(FSNeuronGene(input, i, 0.1 + i * InputRowSlice, 0.0));
+		NewNeurons.Add(FSNeuronGene(input, i, 0.1 + i * InputRowSlice, 0.0));
 	}
 
 	//create the bias with ID of numInputs
-	m_Neurons.Add(FSNeuronGene(bias, m_iNumInputs, 1.0, 0.0));
+	NewNeurons.Add(FSNeuronGene(bias, m_iNumInputs, 1.0, 0.0));
 
 	double OutputRowSlice = 1 / (double)(numOutputs + 1);
 
 	//create the output neurons with ID of numInput +1 for the bias to numOutputs
 	for (int i = 0; i < m_iNumOutputs; i++)
 	{
-		m_Neurons.Add(FSNeuronGene(output, i + m_iNumInputs + 1, (i + 1) * OutputRowSlice, 1.0));
+		NewNeurons.Add(FSNeuronGene(output, i + m_iNumInputs + 1, (i + 1) * OutputRowSlice, 1.0));
 	}
 
-	//Used so that the links are listed after all nodes in the innovation list
-	int iNextLinkNumber = 1;
+	//Used so that the links are listed after all nodes in the innovation list. Starts at 0 so the IDs match the ones
+	//UInnovation::Initialize hands out for the start links
+	int iNextLinkNumber = 0;
 	//create the link genes, connect each input neuron to each output neuron and assign a random weight -1 < w < 1
 	//first iterate over all inputs +1 for the bias
 	for (int i = 0; i < m_iNumInputs + 1; ++i)
@@ -72,7 +81,7 @@ void UGenome::InitializeStandard(int id, int numInputs, int numOutputs, AMyGameM
 		for (int j = 0; j < m_iNumOutputs; ++j)
 		{
 			//toNeuron has +1 for the bias
-			m_Links.Add(FSLinkGene(m_Neurons[i].iID, m_Neurons[m_iNumInputs + j + 1].iID, RandomClamped(), true, m_iNumInputs + m_iNumOutputs + 1 + iNextLinkNumber));
+			NewLinks.Add(FSLinkGene(NewNeurons[i].iID, NewNeurons[m_iNumInputs + j + 1].iID, RandomClamped(), true, m_iNumInputs + m_iNumOutputs + 1 + iNextLinkNumber));
 			++iNextLinkNumber;
 		}
 	}
@@ -84,8 +93,10 @@ void UGenome::InitializeCustom(int id, TArray<FSNeuronGene> neurons, TArray<FSLi
 {
 	m_GenomeID = id;
 	m_Phenotype = NULL;
-	m_Links = genes;
-	m_Neurons = neurons;
+	m_Genes = MakeShared<FSGeneStorage, ESPMode::ThreadSafe>();
+	s_GeneStorageAllocations.Increment();
+	m_Genes->Links = MoveTemp(genes);
+	m_Genes->Neurons = MoveTemp(neurons);
 	m_dSpawnAmount = 0;
 	m_dFitness = 0;
 	m_dSpeciesFitness = 0;
@@ -94,41 +105,99 @@ void UGenome::InitializeCustom(int id, TArray<FSNeuronGene> neurons, TArray<FSLi
 	m_GameMode = gameMode;
 }
 
+FSGeneStorage& UGenome::InitializeEmpty(int id, int numNeurons, int numLinks, int nrInputs, int nrOutputs, AMyGameMode* gameMode)
+{
+	InitializeCustom(id, TArray<FSNeuronGene>(), TArray<FSLinkGene>(), nrInputs, nrOutputs, gameMode);
+
+	m_Genes->Neurons.Reserve(numNeurons);
+	m_Genes->Links.Reserve(numLinks);
+
+	return *m_Genes;
+}
+
+UGenome* UGenome::CreateCopy(UObject* outer) const
+{
+	UGenome* Copy = NewObject<UGenome>(outer);
+	Copy->CopyFrom(this);
+
+	return Copy;
+}
+
+void UGenome::CopyFrom(const UGenome* other)
+{
+	m_GameMode = other->m_GameMode;
+	m_GenomeID = other->m_GenomeID;
+	m_Genes = other->m_Genes;
+	m_Phenotype = nullptr;
+	m_iDepth = other->m_iDepth;
+	m_dFitness = other->m_dFitness;
+	m_dSpeciesFitness = other->m_dSpeciesFitness;
+	m_iNumInputs = other->m_iNumInputs;
+	m_iNumOutputs = other->m_iNumOutputs;
+	m_iSpecies = other->m_iSpecies;
+	m_dSpawnAmount = other->m_dSpawnAmount;
+	m_PendingInnovations = other->m_PendingInnovations;
+	m_iNextProvisionalID = other->m_iNextProvisionalID;
+}
+
+int UGenome::ConsumeGeneStorageAllocations()
+{
+	return s_GeneStorageAllocations.Reset();
+}
+
+FSGeneStorage& UGenome::MutableGenes()
+{
+	//another genome still reads these genes, detach before the first write
+	if (!m_Genes.IsUnique())
+	{
+		TSharedPtr<FSGeneStorage, ESPMode::ThreadSafe> OwnGenes = MakeShared<FSGeneStorage, ESPMode::ThreadSafe>();
+		OwnGenes->Neurons = m_Genes->Neurons;
+		OwnGenes->Links = m_Genes->Links;
+		m_Genes = OwnGenes;
+		s_GeneStorageAllocations.Increment();
+	}
+	m_Genes->PackedLinks.bValid = false;
+	m_Genes->bContentHashValid = false;
+	return *m_Genes;
+}
+
 void UGenome::InitializeWeights()
 {
-	for (FSLinkGene curLink : m_Links)
+	for (FSLinkGene curLink : Links())
 	{
 		curLink.dWeight = RandFloat(-1.0, 1.0);
 	}
 }
 
-void UGenome::ToggleLinkGenes(double toggleChance, int numTries)
+void UGenome::ToggleLinkGenes(double toggleChance, int numTries, FRandomStream &rng)
 {
-	TArray<FSLinkGene>::TIterator checkgene = m_Links.CreateIterator();
+	//position of the check walk, kept across tries
+	int CheckGene = 0;
 
 	while (numTries > 0)
 	{
-		if (RandFloat() < toggleChance)
+		if (RandFloat(rng) < toggleChance)
 		{
-			int RandomLinkGene = RandFloat(0, m_Links.Num());
-			bool bGeneStatus = m_Links[RandomLinkGene].bEnabled;
+			int RandomLinkGene = RandFloat(rng, 0, Links().Num());
+			const FSLinkGene &RandomLink = Links()[RandomLinkGene];
+			bool bGeneStatus = RandomLink.bEnabled;
 
 			if (bGeneStatus == true)
 			{
 				//we need to make sure that another gene connects out of the in-node because if not a section of the network will break off and become isolated
-				while (checkgene && (((checkgene->FromNeuron) != m_Links[RandomLinkGene].FromNeuron) || checkgene->bEnabled == false ||
-					(checkgene->iInnovationID == m_Links[RandomLinkGene].iInnovationID)))
+				while ((CheckGene < Links().Num()) && ((Links()[CheckGene].FromNeuron != RandomLink.FromNeuron) || Links()[CheckGene].bEnabled == false ||
+					(Links()[CheckGene].iInnovationID == RandomLink.iInnovationID)))
 				{
-					++checkgene;
+					++CheckGene;
 				}
-				if (!checkgene)
+				if (CheckGene >= Links().Num())
 				{
-					m_Links[RandomLinkGene].bEnabled = false;
+					MutableGenes().Links[RandomLinkGene].bEnabled = false;
 				}
 			}
 			else if (bGeneStatus == false)
 			{
-				m_Links[RandomLinkGene].bEnabled = true;
+				MutableGenes().Links[RandomLinkGene].bEnabled = true;
 			}
 			else
 			{
@@ -139,57 +208,60 @@ void UGenome::ToggleLinkGenes(double toggleChance, int numTries)
 	}
 }
 
-void UGenome::ReenableLinkGenes(double enableChance)
+void UGenome::ReenableLinkGenes(double enableChance, FRandomStream &rng)
 {
-	for (FSLinkGene &curLink : m_Links)
+	for (int i = 0; i < Links().Num(); ++i)
 	{
-		if (curLink.bEnabled == false)
+		if (Links()[i].bEnabled == false)
 		{
-			if (RandFloat() < enableChance)
+			if (RandFloat(rng) < enableChance)
 			{
-				curLink.bEnabled = true;
+				MutableGenes().Links[i].bEnabled = true;
 			}
 		}
 	}
 }
 
-void UGenome::MutateWeights(double maxMutationPower, double mutationChance, double newWeightChance)
+void UGenome::MutateWeights(double maxMutationPower, double mutationChance, double newWeightChance, FRandomStream &rng)
 {
-	for (FSLinkGene &curLink : m_Links)
+	for (int i = 0; i < Links().Num(); ++i)
 	{
-		if (RandFloat() < mutationChance)
+		if (RandFloat(rng) < mutationChance)
 		{
-			if (RandFloat() < newWeightChance)
+			//only the links that actually change make the genome write to its genes
+			FSLinkGene &curLink = MutableGenes().Links[i];
+
+			if (RandFloat(rng) < newWeightChance)
 			{
-				curLink.dWeight = RandomClamped();
+				curLink.dWeight = RandomClamped(rng);
 			}
 			else
 			{
 				double weight = curLink.dWeight;
-				weight += RandFloat(-maxMutationPower, maxMutationPower);
+				weight += RandFloat(rng, -maxMutationPower, maxMutationPower);
 				curLink.dWeight = weight;
 			}
 		}
 	}
 }
 
-void UGenome::MutateAddNode(UInnovation & innovationList, double mutationChance, int numTries)
+void UGenome::MutateAddNode(UInnovation & innovationList, double mutationChance, int numTries, FRandomStream &rng)
 {
-	if (RandFloat() > mutationChance)
+	if (RandFloat(rng) > mutationChance)
 	{
 		return;
 	}
 
 	bool bFoundLink = false;
 
-	FSLinkGene *SelectedLink = new FSLinkGene();
+	FSLinkGene SelectedLink;
 
 	//select random link to split numTries times
 	while (numTries > 0)
 	{
 
 		int AlreadyTriedThisLink = -1;
-		int RandLinkID = RandInt(0, m_Links.Num() - 1);
+		int RandLinkID = RandInt(rng, 0, Links().Num() - 1);
 
 		//start new if we already tried with this link
 		if (RandLinkID == AlreadyTriedThisLink)
@@ -197,10 +269,10 @@ void UGenome::MutateAddNode(UInnovation & innovationList, double mutationChance,
 			continue;
 		}
 
-		*SelectedLink = m_Links[RandLinkID];
+		SelectedLink = Links()[RandLinkID];
 
 		//search new link if selected link is disabled or has a bias neuron as its input
-		if ((SelectedLink->bEnabled == false) || (m_Neurons[GetNeuronPosFromID(SelectedLink->FromNeuron)].NeuronType == bias))
+		if ((SelectedLink.bEnabled == false) || (Neurons()[GetNeuronPosFromID(SelectedLink.FromNeuron)].NeuronType == bias))
 		{
 			AlreadyTriedThisLink = RandLinkID;
 			--numTries;
@@ -217,84 +289,48 @@ void UGenome::MutateAddNode(UInnovation & innovationList, double mutationChance,
 		return;
 	}
 
-	SelectedLink->bEnabled = false;
+	SelectedLink.bEnabled = false;
 
 	//new link leading into the new node has its weight set to 1, the link leading out gets the old weight
-	double NewLinkWeight = SelectedLink->dWeight;
-
-	int FromNeuronID = SelectedLink->FromNeuron;
-	int ToNeuronID = SelectedLink->ToNeuron;
+	double NewLinkWeight = SelectedLink.dWeight;
 
-	double NewDepth = (m_Neurons[GetNeuronPosFromID(FromNeuronID)].dSplitY + m_Neurons[GetNeuronPosFromID(ToNeuronID)].dSplitY) / 2;
-	double NewWidth = (m_Neurons[GetNeuronPosFromID(FromNeuronID)].dSplitX + m_Neurons[GetNeuronPosFromID(ToNeuronID)].dSplitX) / 2;
+	int FromNeuronID = SelectedLink.FromNeuron;
+	int ToNeuronID = SelectedLink.ToNeuron;
 
-	int InnovationID = innovationList.CheckForInnovation(FromNeuronID, ToNeuronID, new_neuron);
+	double NewDepth = (Neurons()[GetNeuronPosFromID(FromNeuronID)].dSplitY + Neurons()[GetNeuronPosFromID(ToNeuronID)].dSplitY) / 2;
+	double NewWidth = (Neurons()[GetNeuronPosFromID(FromNeuronID)].dSplitX + Neurons()[GetNeuronPosFromID(ToNeuronID)].dSplitX) / 2;
 
-	//If innovation already exists check if the neuronID of that innovation is already used by the genome
-	if (InnovationID >= 0)
-	{
-		int NeuronID = innovationList.GetNeuronID(InnovationID);
+	int NewNeuronID, LinkOneID, LinkTwoID;
 
-		if (GenomeAlreadyHasNeuronID(NeuronID))
-		{
-			//if yes we need a new innovation
-			InnovationID = -1;
-		}
-	}
-
-	if (InnovationID < 0)
+	if (innovationList.IsStaging())
 	{
-		//create new gene for the new neuron
-		int NewNeuronID = innovationList.GetNextNeuronID();
-		FSNeuronGene NewNeuronGene = FSNeuronGene(hidden, NewNeuronID, NewWidth, NewDepth);
-		m_Neurons.Add(NewNeuronGene);
-
-		//then register it in the innovation list
-		innovationList.CreateNewNeuronInnovation(NewNeuronGene, FromNeuronID, ToNeuronID);
-
-		//create new link1 with weight of 1
-		int LinkOneID = innovationList.GetNextInnovationID();
-		FSLinkGene NewLinkGeneOne = FSLinkGene(FromNeuronID, NewNeuronID, 1, true, LinkOneID);
-		m_Links.Add(NewLinkGeneOne);
-		innovationList.CreateNewLinkInnovation(FromNeuronID, NewNeuronID);
-
-		//create new link2 with old weight
-		int LinkTwoID = innovationList.GetNextInnovationID();
-		FSLinkGene NewLinkGeneTwo = FSLinkGene(NewNeuronID, ToNeuronID, NewLinkWeight, true, LinkTwoID);
-		m_Links.Add(NewLinkGeneTwo);
-		innovationList.CreateNewLinkInnovation(NewNeuronID, ToNeuronID);
+		//only propose the neuron, whether an existing innovation can be reused is decided when the proposals are resolved
+		NewNeuronID = m_iNextProvisionalID--;
+		LinkOneID = m_iNextProvisionalID--;
+		LinkTwoID = m_iNextProvisionalID--;
+		m_PendingInnovations.Add(FSInnovationProposal(FromNeuronID, ToNeuronID, NewNeuronID, LinkOneID, LinkTwoID, NewWidth, NewDepth));
 	}
-
-	//the innovation already exists and its neuronID is not in use
 	else
 	{
-		//create new gene for the new neuron
-		int NewNeuronID = innovationList.GetNeuronID(InnovationID);
-		FSNeuronGene NewNeuronGene = FSNeuronGene(hidden, NewNeuronID, NewWidth, NewDepth);
-		m_Neurons.Add(NewNeuronGene);
+		//reuses the innovation if the neuronID of that innovation is not used by the genome yet
+		innovationList.FindOrCreateNeuronInnovation(this, FromNeuronID, ToNeuronID, NewWidth, NewDepth, NewNeuronID, LinkOneID, LinkTwoID);
+	}
 
-		//since the neuron innovation already took place we should also have the 2 link innovations
-		int LinkOneID = innovationList.CheckForInnovation(FromNeuronID, NewNeuronID, new_link);
-		int LinkTwoID = innovationList.CheckForInnovation(NewNeuronID, ToNeuronID, new_link);
+	FSGeneStorage &Genes = MutableGenes();
 
-		if ((LinkOneID < 0) || (LinkTwoID < 0))
-		{
-			GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("Genotype MutateAddNeuron error"));
-		}
+	//create new gene for the new neuron
+	Genes.Neurons.Add(FSNeuronGene(hidden, NewNeuronID, NewWidth, NewDepth));
 
-		//create new link1 with old weight
-		FSLinkGene NewLinkGene1 = FSLinkGene(FromNeuronID, NewNeuronID, NewLinkWeight, true, LinkOneID);
-		m_Links.Add(NewLinkGene1);
+	//create new link1 with weight of 1
+	Genes.Links.Add(FSLinkGene(FromNeuronID, NewNeuronID, 1, true, LinkOneID));
 
-		//create new link2 with weight of 1
-		FSLinkGene NewLinkGene2 = FSLinkGene(NewNeuronID, ToNeuronID, 1, true, LinkTwoID);
-		m_Links.Add(NewLinkGene2);
-	}
+	//create new link2 with old weight
+	Genes.Links.Add(FSLinkGene(NewNeuronID, ToNeuronID, NewLinkWeight, true, LinkTwoID));
 }
 
-void UGenome::MutateAddLink(UInnovation & innovationList, double mutationChance, int numTries)
+void UGenome::MutateAddLink(UInnovation & innovationList, double mutationChance, int numTries, FRandomStream &rng)
 {
-	if (RandFloat() > mutationChance)
+	if (RandFloat(rng) > mutationChance)
 	{
 		return;
 	}
@@ -310,10 +346,10 @@ void UGenome::MutateAddLink(UInnovation & innovationList, double mutationChance,
 	while (numTries > 0)
 	{
 		//rand select first neuron
-		Neuron1ID = m_Neurons[RandInt(0, m_Neurons.Num() - 1)].iID;
+		Neuron1ID = Neurons()[RandInt(rng, 0, Neurons().Num() - 1)].iID;
 
 		//second neuron that's no an input or a bias
-		Neuron2ID = m_Neurons[RandInt(m_iNumInputs + 1, m_Neurons.Num() - 1)].iID;
+		Neuron2ID = Neurons()[RandInt(rng, m_iNumInputs + 1, Neurons().Num() - 1)].iID;
 
 		//check if they are the same
 		if (Neuron1ID == Neuron2ID)
@@ -336,43 +372,73 @@ void UGenome::MutateAddLink(UInnovation & innovationList, double mutationChance,
 		numTries = 0;
 	}
 
-	//couldn't find a possible link
-	if ((Neuron1ID < 0) || (Neuron2ID < 0))
+	//couldn't find a possible link. Provisional IDs are valid neurons, -1 isn't
+	if ((Neuron1ID == -1) || (Neuron2ID == -1))
 	{
 		return;
 	}
 
-	//check to see if we have already created this innovation
-	int InnovationID = innovationList.CheckForInnovation(Neuron1ID, Neuron2ID, new_link);
-
 	//check if this link is a recurrent link
-	if (m_Neurons[GetNeuronPosFromID(Neuron1ID)].dSplitY > m_Neurons[GetNeuronPosFromID(Neuron2ID)].dSplitY)
+	if (Neurons()[GetNeuronPosFromID(Neuron1ID)].dSplitY > Neurons()[GetNeuronPosFromID(Neuron2ID)].dSplitY)
 	{
 		bRecurrent = true;
 	}
 
-	if (InnovationID < 0)
+	int InnovationID;
+
+	if (innovationList.IsStaging())
 	{
-		//create new gene
-		int NewInnovID = innovationList.GetNextInnovationID();
-		FSLinkGene NewGene = FSLinkGene(Neuron1ID, Neuron2ID, RandomClamped(), true, NewInnovID, bRecurrent);
-		m_Links.Add(NewGene);
+		InnovationID = m_iNextProvisionalID--;
+		m_PendingInnovations.Add(FSInnovationProposal(Neuron1ID, Neuron2ID, InnovationID));
+	}
+	else
+	{
+		//uses the existing innovation ID if we have already created this innovation
+		InnovationID = innovationList.FindOrCreateLinkInnovation(Neuron1ID, Neuron2ID);
+	}
+
+	FSLinkGene NewGene = FSLinkGene(Neuron1ID, Neuron2ID, RandomClamped(rng), true, InnovationID, bRecurrent);
+	MutableGenes().Links.Add(NewGene);
+}
+
+void UGenome::ResolveProvisionalIDs(const TMap<int, int> &neuronRemap, const TMap<int, int> &linkRemap)
+{
+	//only called for genomes with pending proposals, which already own their genes
+	FSGeneStorage &Genes = MutableGenes();
 
-		//then register it in the innovation list
-		innovationList.CreateNewLinkInnovation(Neuron1ID, Neuron2ID);
+	for (FSNeuronGene &curNeuron : Genes.Neurons)
+	{
+		if (const int* RealID = neuronRemap.Find(curNeuron.iID))
+		{
+			curNeuron.iID = *RealID;
+		}
 	}
 
-	else
+	for (FSLinkGene &curLink : Genes.Links)
 	{
-		//the innovation already exists, so we create the new gene with the existing innovation ID
-		FSLinkGene NewGene = FSLinkGene(Neuron1ID, Neuron2ID, RandomClamped(), true, InnovationID, bRecurrent);
-		m_Links.Add(NewGene);
+		if (const int* RealFrom = neuronRemap.Find(curLink.FromNeuron))
+		{
+			curLink.FromNeuron = *RealFrom;
+		}
+		if (const int* RealTo = neuronRemap.Find(curLink.ToNeuron))
+		{
+			curLink.ToNeuron = *RealTo;
+		}
+		if (const int* RealID = linkRemap.Find(curLink.iInnovationID))
+		{
+			curLink.iInnovationID = *RealID;
+		}
 	}
+
+	m_PendingInnovations.Empty();
+	m_iNextProvisionalID = -2;
+
+	SortGenes();
 }
 
 bool UGenome::GenomeAlreadyHasNeuronID(int neuronID)
 {
-	for (FSNeuronGene curNeuron : m_Neurons)
+	for (const FSNeuronGene &curNeuron : Neurons())
 	{
 		if (curNeuron.iID == neuronID)
 		{
@@ -384,128 +450,92 @@ bool UGenome::GenomeAlreadyHasNeuronID(int neuronID)
 
 double UGenome::GetCompatibilityScore(UGenome* otherGenome)
 {
-	//count all disjointed, excess and matching genes
-	double	NumDisjoint = 0;
-	double	NumExcess = 0;
-	double	NumMatching = 0;
+	PackLinks();
+	otherGenome->PackLinks();
 
-	//total weight difference of matching genes
-	double	WeightDifference = 0;
+	return FCompatibility::Distance(GetPackedLinks(), otherGenome->GetPackedLinks(), FSCompatibilityCoefficients(m_GameMode->GetParameters()));
+}
+
+void UGenome::PackLinks()
+{
+	FSPackedLinks &Packed = m_Genes->PackedLinks;
 
-	int NumLinkGenesOfBigGenome = BiggerInt(m_Links.Num(), otherGenome->m_Links.Num());
+	if (Packed.bValid)
+	{
+		return;
+	}
 
-	TArray<FSLinkGene>::TIterator CurrentGene1 = m_Links.CreateIterator();
-	TArray<FSLinkGene>::TIterator CurrentGene2 = otherGenome->m_Links.CreateIterator();
+	const TArray<FSLinkGene> &CurLinks = Links();
+	Packed.InnovationIDs.SetNumUninitialized(CurLinks.Num(), false);
+	Packed.Weights.SetNumUninitialized(CurLinks.Num(), false);
 
-	//continue until both iterators reached the end
-	while (CurrentGene1 || CurrentGene2)
+	for (int i = 0; i < CurLinks.Num(); ++i)
 	{
-		//if we reached the end of genome1 count the excess of genome2
-		if (!CurrentGene1)
-		{
-			++CurrentGene2;
-			++NumExcess;
-			continue;
-		}
+		Packed.InnovationIDs[i] = CurLinks[i].iInnovationID;
+		Packed.Weights[i] = CurLinks[i].dWeight;
+	}
+	Packed.bValid = true;
+}
 
-		//if we reached the end of genome2 count the excess of genome1
-		if (!CurrentGene2)
-		{
-			++CurrentGene1;
-			++NumExcess;
-			continue;
-		}
+//mixes one 64 bit value into the hash
+static FORCEINLINE void MixHash(uint64 &hash, uint64 value)
+{
+	hash = (hash ^ value) * 0x9E3779B97F4A7C15ull;
+	hash ^= hash >> 32;
+}
 
-		//get innovation IDs
-		int InnovationID1 = CurrentGene1->iInnovationID;
-		int InnovationID2 = CurrentGene2->iInnovationID;
+static FORCEINLINE uint64 DoubleBits(double value)
+{
+	uint64 Bits;
+	FMemory::Memcpy(&Bits, &value, sizeof(Bits));
+	return Bits;
+}
 
-		//matching gene found
-		if (InnovationID1 == InnovationID2)
-		{
-			//calculate weight difference
-			WeightDifference += fabs(CurrentGene1->dWeight - CurrentGene2->dWeight);
+uint64 UGenome::GetContentHash()
+{
+	FSGeneStorage &Genes = *m_Genes;
 
-			++CurrentGene1;
-			++CurrentGene2;
-			++NumMatching;
-			continue;
-		}
+	if (!Genes.bContentHashValid)
+	{
+		uint64 Hash = 0xCBF29CE484222325ull;
 
-		//disjoint genes
-		if (InnovationID1 < InnovationID2)
+		MixHash(Hash, Genes.Neurons.Num());
+		for (const FSNeuronGene &curNeuron : Genes.Neurons)
 		{
-			++NumDisjoint;
-			++CurrentGene1;
-			continue;
+			MixHash(Hash, ((uint64)(uint32)curNeuron.iID << 8) | (uint64)curNeuron.NeuronType.GetValue());
+			MixHash(Hash, DoubleBits(curNeuron.dSplitX));
+			MixHash(Hash, DoubleBits(curNeuron.dSplitY));
 		}
 
-		if (InnovationID2 < InnovationID1)
+		MixHash(Hash, Genes.Links.Num());
+		for (const FSLinkGene &curLink : Genes.Links)
 		{
-			++NumDisjoint;
-			++CurrentGene2;
-			continue;
+			MixHash(Hash, ((uint64)(uint32)curLink.FromNeuron << 32) | (uint32)curLink.ToNeuron);
+			MixHash(Hash, ((uint64)(uint32)curLink.iInnovationID << 2) | ((uint64)curLink.bEnabled << 1) | (uint64)curLink.bRecurrent);
+			MixHash(Hash, DoubleBits(curLink.dWeight));
 		}
-	}//end while
 
-	 //calculate score
-	double CompatibilityScore =
-		(m_GameMode->GetParameters()->dExcessCoeff * (NumExcess / NumLinkGenesOfBigGenome)) +
-		(m_GameMode->GetParameters()->dDisjointCoeff * (NumDisjoint / NumLinkGenesOfBigGenome)) +
-		(m_GameMode->GetParameters()->dMatchingCoeff * (WeightDifference / NumMatching));
-
-	return CompatibilityScore;
+		Genes.ContentHash = Hash;
+		Genes.bContentHashValid = true;
+	}
+	return Genes.ContentHash;
 }
 
-UNeuralNet* UGenome::CreatePhenotype()
+UNeuralNet* UGenome::CreatePhenotype(FGenerationArena* arena)
 {
 	//make sure there is no existing phenotype for this genome
 	DeletePhenotype();
 
-	//all the neurons required for the phenotype
-	TArray<UNeuron*> vNeurons;
-
-	//create all the required neurons
-	for (FSNeuronGene curNeuron : m_Neurons)
-	{
-		UNeuron* NewNeuron = NewObject<UNeuron>();
-		NewNeuron->Initialize(curNeuron.NeuronType, curNeuron.iID, curNeuron.dSplitX, curNeuron.dSplitY);
-		vNeurons.Add(NewNeuron);
-	}
-
-	//create the links. 
-	for (FSLinkGene curLink : m_Links)
-	{
-		//make sure the link gene is enabled before the connection is created
-		if (curLink.bEnabled)
-		{
-			//get the pointers to the relevant neurons
-			int element = GetNeuronPosFromID(curLink.FromNeuron);
-			UNeuron* FromNeuron = vNeurons[element];
-
-			element = GetNeuronPosFromID(curLink.ToNeuron);
-			UNeuron* ToNeuron = vNeurons[element];
-
-			//create a link between those two neurons and assign the weight stored in the gene
-			ULink* NewLink = NewObject<ULink>();
-			NewLink->Initialize(FromNeuron, ToNeuron, curLink.dWeight, curLink.bRecurrent);
-
-			//add new links to neuron
-			FromNeuron->m_LinksOut.Add(NewLink);
-			ToNeuron->m_LinksIn.Add(NewLink);
-		}
-	}
-
-	//create neural net from all neurons
+	//create neural net from all neurons and enabled links
 	m_Phenotype = NewObject<UNeuralNet>();
-	m_Phenotype->Initialize(vNeurons, m_iDepth);
+	m_Phenotype->Initialize(Neurons(), Links(), m_iDepth, arena);
 
 	return m_Phenotype;
 }
 
 bool UGenome::DuplicateLink(int NeuronIn, int NeuronOut)
 {
-	for (FSLinkGene curLink : m_Links)
+	for (const FSLinkGene &curLink : Links())
 	{
 		if ((curLink.FromNeuron == NeuronIn) && (curLink.ToNeuron == NeuronOut))
 		{
@@ -518,9 +548,9 @@ bool UGenome::DuplicateLink(int NeuronIn, int NeuronOut)
 
 int UGenome::GetNeuronPosFromID(int neuronID)
 {
-	for (int i = 0; i < m_Neurons.Num(); ++i)
+	for (int i = 0; i < Neurons().Num(); ++i)
 	{
-		if (m_Neurons[i].iID == neuronID)
+		if (Neurons()[i].iID == neuronID)
 		{
 			return i;
 		}
@@ -532,7 +562,16 @@ int UGenome::GetNeuronPosFromID(int neuronID)
 
 void UGenome::SortGenes()
 {
-	m_Links.Sort();
+	//a shared storage is usually sorted already, don't detach it just to find that out
+	const TArray<FSLinkGene> &CurLinks = Links();
+	for (int i = 1; i < CurLinks.Num(); ++i)
+	{
+		if (CurLinks[i] < CurLinks[i - 1])
+		{
+			MutableGenes().Links.Sort();
+			return;
+		}
+	}
 }
 
 void UGenome::DeletePhenotype() 
@@ -544,7 +583,7 @@ void UGenome::CalculateNetDepth(TArray<FSplitDepth> FSplitDepths)
 {
 	int MaxSoFar = 0;
 
-	for (FSNeuronGene curNeuron : m_Neurons)
+	for (const FSNeuronGene &curNeuron : Neurons())
 	{
 		for (int j = 0; j < FSplitDepths.Num(); ++j)
 		{
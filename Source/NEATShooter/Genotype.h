@@ -15,8 +15,10 @@
 #pragma once
 
 #include "Globals.h"
+#include "Compatibility.h"
 
 #include "CoreMinimal.h"
+#include "HAL/ThreadSafeCounter.h"
 #include "GameFramework/Info.h"
 #include "Genotype.generated.h"
 
@@ -25,6 +27,7 @@ class UInnovation;
 class UGenome;
 class UNeuralNet;
 class AMyGameMode;
+class FGenerationArena;
 struct FSplitDepth;
 struct FSNeuronGene;
 struct FSLinkGene;
@@ -95,6 +98,64 @@ struct FSLinkGene
 	//}
 };
 
+//A structural mutation a genome made while the innovation list was staging. The genome uses provisional (negative) IDs
+//until UInnovation::ResolveStagedInnovations replaces them with real ones
+USTRUCT()
+struct FSInnovationProposal
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+		//true for a new neuron, false for a new link
+		bool bNewNeuron;
+
+	//neurons the new link connects or the split link connected. May be provisional IDs themselves
+	UPROPERTY()
+		int FromNeuron;
+	UPROPERTY()
+		int ToNeuron;
+
+	//provisional IDs used by the genome. For a new neuron LinkID is the link into it and SecondLinkID the link out of it
+	UPROPERTY()
+		int NeuronID;
+	UPROPERTY()
+		int LinkID;
+	UPROPERTY()
+		int SecondLinkID;
+
+	UPROPERTY()
+		double dSplitX;
+	UPROPERTY()
+		double dSplitY;
+
+	FSInnovationProposal() { bNewNeuron = false; FromNeuron = -1; ToNeuron = -1; NeuronID = -1; LinkID = -1; SecondLinkID = -1; dSplitX = 0; dSplitY = 0; }
+
+	//proposal of a new link
+	FSInnovationProposal(int fromNeuron, int toNeuron, int linkID) : bNewNeuron(false), FromNeuron(fromNeuron), ToNeuron(toNeuron),
+		NeuronID(-1), LinkID(linkID), SecondLinkID(-1), dSplitX(0), dSplitY(0) {}
+
+	//proposal of a new neuron splitting the link fromNeuron -> toNeuron
+	FSInnovationProposal(int fromNeuron, int toNeuron, int neuronID, int linkInID, int linkOutID, double splitX, double splitY) : bNewNeuron(true),
+		FromNeuron(fromNeuron), ToNeuron(toNeuron), NeuronID(neuronID), LinkID(linkInID), SecondLinkID(linkOutID), dSplitX(splitX), dSplitY(splitY) {}
+};
+
+//The genes of a genome. Shared by all copies of a genome until one of them writes to it
+struct FSGeneStorage
+{
+	//the vector of neurons has the input neurons first from 0 to numInputs, then one bias neuron, then output neurons, then hidden neurons
+	TArray<FSNeuronGene> Neurons;
+	TArray<FSLinkGene> Links;
+
+	//copy of the links for the compatibility kernel, invalidated by every write
+	FSPackedLinks PackedLinks;
+
+	//hash over all genes, valid until the next write
+	uint64 ContentHash;
+	bool bContentHashValid;
+
+	FSGeneStorage() : ContentHash(0), bContentHashValid(false) {}
+};
+
 //This class stores the genetic information (genotype) of the organisms (NNSpaceShip). Used to create the phenotype and to mutate itself
 UCLASS()
 class NEATSHOOTER_API UGenome : public UObject
@@ -108,11 +169,11 @@ private:
 	UPROPERTY()
 	int m_GenomeID;
 
-	UPROPERTY()
-		//the vector of neurons has the input neurons first from 0 to numInputs, then one bias neuron, then output neurons, then hidden neurons
-		TArray<FSNeuronGene> m_Neurons;
-	UPROPERTY()
-		TArray<FSLinkGene> m_Links;
+	//neuron and link genes, copy on write. Only valid after one of the Initialize functions or CreateCopy
+	TSharedPtr<FSGeneStorage, ESPMode::ThreadSafe> m_Genes;
+
+	//number of gene storages created so far, by initializing or by detaching a shared one
+	static FThreadSafeCounter s_GeneStorageAllocations;
 
 	UPROPERTY()
 		UNeuralNet* m_Phenotype;
@@ -140,7 +201,20 @@ private:
 		//number of offspring to be produced by this genome
 		double m_dSpawnAmount;
 
+	UPROPERTY()
+		//structural mutations waiting for their real IDs while the innovation list is staging
+		TArray<FSInnovationProposal> m_PendingInnovations;
+	UPROPERTY()
+		//next provisional ID, counts down from -2 because -1 already means 'no ID'
+		int m_iNextProvisionalID;
+
+
 
+	const TArray<FSNeuronGene>& Neurons() const { return m_Genes->Neurons; }
+	const TArray<FSLinkGene>& Links() const { return m_Genes->Links; }
+
+	//Returns the genes for writing. Gives the genome its own copy first if the storage is shared
+	FSGeneStorage& MutableGenes();
 
 	//returns true if both neurons are already linked
 	bool DuplicateLink(int NeuronIn, int NeuronOut);
@@ -159,18 +233,38 @@ public:
 	//Creates a network where all inputs are connected with outputs
 	void InitializeStandard(int id, int nrInputs, int nrOutputs, AMyGameMode* gameMode);
 	void InitializeCustom(int id, TArray<FSNeuronGene> neurons, TArray<FSLinkGene> genes, int nrInputs, int nrOutputs, AMyGameMode* gameMode);
+	//Gives the genome empty genes with room for the given number of genes and returns them to be filled in
+	FSGeneStorage& InitializeEmpty(int id, int numNeurons, int numLinks, int nrInputs, int nrOutputs, AMyGameMode* gameMode);
+
+	//Returns a new genome with the same genes and scores. The genes are shared until one of the two genomes is mutated
+	UGenome* CreateCopy(UObject* outer) const;
+	//Turns this genome into a copy of other, sharing its genes. Doesn't create objects and can be used off the game thread
+	void CopyFrom(const UGenome* other);
+
+	//Returns the number of gene storages allocated since the last call
+	static int ConsumeGeneStorageAllocations();
 
-	//Create phenotype from genome and return its pointer
-	UNeuralNet*	CreatePhenotype();
+	//Create phenotype from genome and return its pointer. Without an arena the phenotype owns its memory
+	UNeuralNet*	CreatePhenotype(FGenerationArena* arena = nullptr);
 
 	void DeletePhenotype();
 
 	//Returns true if the genome already has a specific neuron
 	bool GenomeAlreadyHasNeuronID(int neuronID);
 
-	//Calculates and returns the compatibility score with another genome
+	//Calculates and returns the compatibility score with another genome. Packs the links of both, so not for worker threads
 	double GetCompatibilityScore(UGenome* otherGenome);
 
+	//Brings the packed links up to date. Genomes can share their genes, so call this from the game thread only
+	void PackLinks();
+
+	//The links as used by the compatibility kernel. Only valid after PackLinks and until the next mutation
+	const FSPackedLinks& GetPackedLinks() const { return m_Genes->PackedLinks; }
+
+	//Returns a hash of all neuron and link genes. Genomes with equal genes have equal hashes.
+	//Computed on first use after a change, call from the game thread before handing the genome to workers
+	uint64 GetContentHash();
+
 	//Initializes all the link weights to random values in ]-1,1[
 	void InitializeWeights();
 
@@ -181,20 +275,27 @@ public:
 	void CalculateNetDepth(TArray<FSplitDepth> FSplitDepths);
 
 	//----------------Mutator functions---------------------//
+	//They only touch this genome and draw from the passed stream, so different genomes can be mutated on different threads
+	//as long as the innovation list is staging
 	//Toggle links on or off 
-	void ToggleLinkGenes(double toggleChance, int numTries);
+	void ToggleLinkGenes(double toggleChance, int numTries, FRandomStream &rng);
 
 	//Enables disabled linkGenes
-	void ReenableLinkGenes(double enableChance);
+	void ReenableLinkGenes(double enableChance, FRandomStream &rng);
 
 	//Mutate the genome by altering the connection weights
-	void MutateWeights(double maxMutationPower, double mutationChance, double newWeightChance);
+	void MutateWeights(double maxMutationPower, double mutationChance, double newWeightChance, FRandomStream &rng);
 
 	//Mutate the genome by adding a neural node 
-	void MutateAddNode(UInnovation &innovationList, double mutationChance, int numTries);
+	void MutateAddNode(UInnovation &innovationList, double mutationChance, int numTries, FRandomStream &rng);
 
 	//Mutate the genome by adding a new link between 2 random neural nodes
-	void MutateAddLink(UInnovation &innovationList, double mutationChance, int numTries);
+	void MutateAddLink(UInnovation &innovationList, double mutationChance, int numTries, FRandomStream &rng);
+
+	//Replaces the provisional IDs of the staged mutations with the real ones, drops the proposals and sorts the genes
+	void ResolveProvisionalIDs(const TMap<int, int> &neuronRemap, const TMap<int, int> &linkRemap);
+
+	const TArray<FSInnovationProposal>& GetPendingInnovations() const { return m_PendingInnovations; }
 
 
 
@@ -204,8 +305,8 @@ public:
 	int GetDepth() { return m_iDepth; }
 	void SetDepth(int depth) { m_iDepth = depth; }
 
-	int GetNumLinkGenes() { return m_Links.Num(); }
-	int GetNumNeuronGenes() { return m_Neurons.Num(); }
+	int GetNumLinkGenes() const { return Links().Num(); }
+	int GetNumNeuronGenes() const { return Neurons().Num(); }
 	int GetNumInputs() { return m_iNumInputs; }
 	int GetNumOutputs() { return m_iNumOutputs; }
 
@@ -217,13 +318,13 @@ public:
 	double GetFitness() { return m_dFitness; }
 	double GetSpeciesFitness() { return m_dSpeciesFitness; }
 
-	double GetSplitY(int id) { return m_Neurons[id].dSplitY; }
+	double GetSplitY(int id) const { return Neurons()[id].dSplitY; }
 
 	int GetSpecies() { return m_iSpecies; }
 	void SetSpecies(int species) { m_iSpecies = species; }
 
 	UNeuralNet* GetPhenotype() { return m_Phenotype; }
 
-	TArray<FSLinkGene> GetLinkGenesList() { return m_Links; }
-	TArray<FSNeuronGene> GetNeuronGenesList() { return m_Neurons; }
+	const TArray<FSLinkGene>& GetLinkGenesList() const { return Links(); }
+	const TArray<FSNeuronGene>& GetNeuronGenesList() const { return Neurons(); }
 };
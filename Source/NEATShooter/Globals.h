@@ -55,6 +55,16 @@ enum run_type
 	active 
 };
 
+//how the parents for crossover are drawn from the surviving members of a species.
+//truncation draws uniformly, the others weight by fitness or by linear rank
+UENUM()
+enum parent_selection
+{
+	truncation,
+	fitness_proportional,
+	rank_based
+};
+
 //for futer use of printing genomes to file
 template<typename T>
 static FString EnumToString(const FString& enumName, const T value)
@@ -139,6 +149,23 @@ FORCEINLINE double RandFloat(float min = 0, float max = 1)
 	return (random * range) + min;
 }
 
+//the same helpers drawing from a given stream, for code that must not share rand() with other threads
+FORCEINLINE int RandInt(FRandomStream &rng, int x, int y) { return rng.RandRange(x, y); }
+
+FORCEINLINE double RandFloat(FRandomStream &rng, float min = 0, float max = 1)
+{
+	return (rng.GetFraction() * (max - min)) + min;
+}
+
+//returns the number of set bits
+FORCEINLINE int PopCount64(uint64 x)
+{
+	x = x - ((x >> 1) & 0x5555555555555555ull);
+	x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+	x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+	return (int)((x * 0x0101010101010101ull) >> 56);
+}
+
 //returns the bigger number
 FORCEINLINE int BiggerInt(int var1, int var2)
 {
@@ -173,3 +200,9 @@ FORCEINLINE bool RandBool()
 
 //returns a random float in the range -1 < n < 1
 FORCEINLINE double RandomClamped() { return RandFloat() - RandFloat(); }
+FORCEINLINE double RandomClamped(FRandomStream &rng)
+{
+	//draw in a fixed order so every compiler produces the same sequence
+	double First = RandFloat(rng);
+	return First - RandFloat(rng);
+}
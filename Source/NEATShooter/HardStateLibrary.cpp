@@ -0,0 +1,78 @@
+//Copyright 2018 Raphael Haucke
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+//http ://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+
+#include "HardStateLibrary.h"
+#include "Parameters.h"
+#include "Scenario.h"
+
+
+
+FHardStateLibrary::FHardStateLibrary()
+{
+	m_Parameters = nullptr;
+}
+
+void FHardStateLibrary::Initialize(const UParameters* parameters)
+{
+	m_Parameters = parameters;
+}
+
+void FHardStateLibrary::Build(FHeadlessSimulation &simulation, UNeuralNet* net, const FScenarioLibrary &scenarios, int firstScenario)
+{
+	m_States.Reset();
+
+	float DeltaTime = m_Parameters->fHeadlessTimeStep;
+	if (DeltaTime <= 0.f)
+	{
+		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("HardStateLibrary Build fHeadlessTimeStep has to be positive"));
+		return;
+	}
+
+	//a fork needs the time to play before the run would end anyway
+	float LastCaptureTime = m_Parameters->fTimeLeftToPlay - m_Parameters->fForkDuration;
+
+	if (!net->IsUsable())
+	{
+		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("HardStateLibrary Build the net is from an old generation"));
+		return;
+	}
+
+	for (int i = 0; i < scenarios.Num() && m_States.Num() < m_Parameters->iNumHardStates; ++i)
+	{
+		simulation.Reset(scenarios.Get(firstScenario + i), net);
+
+		float TimeOfLastState = -m_Parameters->fHardStateSpacing;
+		while (m_States.Num() < m_Parameters->iNumHardStates && simulation.Step(net, DeltaTime))
+		{
+			float TimePlayed = simulation.GetTimePlayed();
+			if (TimePlayed > LastCaptureTime)
+			{
+				break;
+			}
+
+			if (TimePlayed - TimeOfLastState >= m_Parameters->fHardStateSpacing && simulation.GetNumBodies() >= m_Parameters->iHardStateMinBodies)
+			{
+				int NewState = m_States.AddDefaulted();
+				simulation.CaptureState(m_States[NewState], net);
+				TimeOfLastState = TimePlayed;
+			}
+		}
+
+		if (simulation.HasFailed())
+		{
+			GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("HardStateLibrary Build the net couldn't play"));
+			return;
+		}
+	}
+}
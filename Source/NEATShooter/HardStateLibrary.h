@@ -0,0 +1,45 @@
+//Copyright 2018 Raphael Haucke
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+//http ://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+
+#pragma once
+
+#include "HeadlessSimulation.h"
+
+#include "CoreMinimal.h"
+
+
+class UParameters;
+
+
+//Crowded moments of headless runs, captured once so every genome can be forked from them for a few seconds instead of
+//playing the easy opening of a whole episode to get there
+class NEATSHOOTER_API FHardStateLibrary
+{
+private:
+	const UParameters* m_Parameters;
+
+	TArray<FSSimSnapshot> m_States;
+
+public:
+	FHardStateLibrary();
+
+	void Initialize(const UParameters* parameters);
+
+	//Lets the net play the scenarios from firstScenario on and captures every state with at least iHardStateMinBodies
+	//bodies, fHardStateSpacing seconds apart, until iNumHardStates are found or every scenario was played once
+	void Build(FHeadlessSimulation &simulation, UNeuralNet* net, const FScenarioLibrary &scenarios, int firstScenario);
+
+	const TArray<FSSimSnapshot>& GetStates() const { return m_States; }
+	int Num() const { return m_States.Num(); }
+};
@@ -0,0 +1,409 @@
+//Copyright 2018 Raphael Haucke
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+//http ://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+
+#include "HeadlessSimulation.h"
+#include "Parameters.h"
+#include "Phenotype.h"
+
+
+
+//UCollidingPawnMovementComponent::MovementSpeed, the projectile movement and AEnemySpaceship::FireRate
+const float FHeadlessSimulation::ShipSpeed = 600.f;
+const float FHeadlessSimulation::ProjectileSpeed = 600.f;
+const float FHeadlessSimulation::EnemyFireRate = 2.f;
+//far enough in front of the shooter that the projectile does not start inside it
+const float FHeadlessSimulation::MuzzleDistance = 100.f;
+const float FHeadlessSimulation::CullMargin = 200.f;
+
+//half sizes of the collision boxes of the actors
+static const FVector2D ShipExtent(80.f, 50.f);
+static const FVector2D DestructibleExtent(80.f, 80.f);
+static const FVector2D EnemyExtent(80.f, 50.f);
+static const FVector2D ProjectileExtent(15.f, 15.f);
+
+FHeadlessSimulation::FHeadlessSimulation()
+{
+	m_Parameters = nullptr;
+	m_PlayerStartPosition = FVector2D(0.f, 0.f);
+	m_iHealth = 0;
+	m_dFitness = 0.0;
+	m_fShotCooldown = 0.f;
+	m_fNetDistanceMoved = 0.f;
+	m_fLastTickYPosition = 0.f;
+	m_Scenario = nullptr;
+	m_fTimePlayed = 0.f;
+	m_bFailed = false;
+}
+
+void FHeadlessSimulation::Initialize(const UParameters* parameters, const FNNInputGrid &grid, const FSpawnZone &spawnZone, FVector2D playerStartPosition)
+{
+	m_Parameters = parameters;
+	m_Grid = grid;
+	m_SpawnZone = spawnZone;
+	m_PlayerStartPosition = playerStartPosition;
+}
+
+void FHeadlessSimulation::Reset(const FScenario &scenario, UNeuralNet* net)
+{
+	//every episode is an independent sample, nothing carries over from the net's last run
+	net->ResetActivations();
+
+	m_Scenario = &scenario;
+	m_Cursor = FSScenarioCursor();
+
+	m_Destructibles.Reset();
+	m_Enemies.Reset();
+	m_Projectiles.Reset();
+
+	m_Ship = FSSimBody();
+	m_Ship.Location = m_PlayerStartPosition;
+	m_Ship.Extent = ShipExtent;
+	m_iHealth = m_Parameters->iShipHealth;
+	m_dFitness = 0.0;
+	m_fShotCooldown = 0.f;
+	m_fNetDistanceMoved = 0.f;
+	m_fLastTickYPosition = m_Ship.Location.Y;
+
+	m_fTimePlayed = 0.f;
+	m_bFailed = false;
+}
+
+bool FHeadlessSimulation::Step(UNeuralNet* net, float deltaTime)
+{
+	if (IsFinished())
+	{
+		return false;
+	}
+
+	//same order as a frame in the level: spawns, the net, rewards, then movement and hits
+	SpawnDestructibleOnTimer(deltaTime);
+	if (m_Parameters->bSimpleMode == false)
+	{
+		SpawnEnemySpaceshipOnTimer(deltaTime);
+	}
+
+	UpdateShip(net, deltaTime);
+
+	m_fTimePlayed += deltaTime;
+	m_dFitness += deltaTime * m_Parameters->fFitnessPerSecond;
+	MovementReward();
+
+	MoveBodies(deltaTime);
+	ResolveHits();
+	RemoveDeadBodies();
+
+	return !IsFinished();
+}
+
+double FHeadlessSimulation::Run(UNeuralNet* net, const FScenario &scenario)
+{
+	float DeltaTime = m_Parameters->fHeadlessTimeStep;
+	if (DeltaTime <= 0.f || !net->IsUsable())
+	{
+		m_bFailed = true;
+		return 0.0;
+	}
+
+	Reset(scenario, net);
+
+	while (Step(net, DeltaTime))
+	{
+	}
+
+	return m_dFitness;
+}
+
+bool FHeadlessSimulation::IsFinished() const
+{
+	return m_fTimePlayed > m_Parameters->fTimeLeftToPlay || m_iHealth < 1 || m_dFitness <= m_Parameters->fFitnessCutoff;
+}
+
+void FHeadlessSimulation::CaptureState(FSSimSnapshot &outSnapshot, const UNeuralNet* net) const
+{
+	outSnapshot.Destructibles = m_Destructibles;
+	outSnapshot.Enemies = m_Enemies;
+	outSnapshot.Projectiles = m_Projectiles;
+
+	outSnapshot.Ship = m_Ship;
+	outSnapshot.iHealth = m_iHealth;
+	outSnapshot.dFitness = m_dFitness;
+	outSnapshot.fShotCooldown = m_fShotCooldown;
+	outSnapshot.fNetDistanceMoved = m_fNetDistanceMoved;
+	outSnapshot.fLastTickYPosition = m_fLastTickYPosition;
+	outSnapshot.fTimePlayed = m_fTimePlayed;
+
+	outSnapshot.Scenario = m_Scenario;
+	outSnapshot.Cursor = m_Cursor;
+
+	net->CaptureActivations(outSnapshot.NetActivations);
+}
+
+void FHeadlessSimulation::RestoreState(const FSSimSnapshot &snapshot, UNeuralNet* net)
+{
+	m_Destructibles = snapshot.Destructibles;
+	m_Enemies = snapshot.Enemies;
+	m_Projectiles = snapshot.Projectiles;
+
+	m_Ship = snapshot.Ship;
+	m_iHealth = snapshot.iHealth;
+	m_dFitness = snapshot.dFitness;
+	m_fShotCooldown = snapshot.fShotCooldown;
+	m_fNetDistanceMoved = snapshot.fNetDistanceMoved;
+	m_fLastTickYPosition = snapshot.fLastTickYPosition;
+	m_fTimePlayed = snapshot.fTimePlayed;
+
+	m_Scenario = snapshot.Scenario;
+	m_Cursor = snapshot.Cursor;
+	m_bFailed = false;
+
+	net->RestoreActivations(snapshot.NetActivations);
+}
+
+double FHeadlessSimulation::RunFork(UNeuralNet* net, const FSSimSnapshot &snapshot, float duration)
+{
+	float DeltaTime = m_Parameters->fHeadlessTimeStep;
+	if (DeltaTime <= 0.f || !net->IsUsable())
+	{
+		m_bFailed = true;
+		return 0.0;
+	}
+
+	RestoreState(snapshot, net);
+
+	float EndTime = snapshot.fTimePlayed + duration;
+	while (m_fTimePlayed < EndTime && Step(net, DeltaTime))
+	{
+	}
+
+	return m_dFitness - snapshot.dFitness;
+}
+
+void FHeadlessSimulation::SpawnDestructibleOnTimer(float deltaTime)
+{
+	m_Cursor.fDestructibleTime += deltaTime;
+
+	while (const FSSpawnEvent* Event = m_Scenario->PopDestructible(m_Cursor))
+	{
+		FSSimBody Destructible;
+		Destructible.Location = FVector2D(m_SpawnZone.m_UpX, FScenario::GetSpawnY(m_SpawnZone, Event->iSpawnPoint));
+		Destructible.Extent = DestructibleExtent;
+		Destructible.Velocity = FVector2D(-Event->fVertSpeed, 0.f);
+		m_Destructibles.Add(Destructible);
+	}
+}
+
+void FHeadlessSimulation::SpawnEnemySpaceshipOnTimer(float deltaTime)
+{
+	m_Cursor.fEnemyTime += deltaTime;
+
+	while (const FSSpawnEvent* Event = m_Scenario->PopEnemy(m_Cursor))
+	{
+		FSSimBody EnemyShip;
+		EnemyShip.Location = FVector2D(m_SpawnZone.m_UpX, FScenario::GetSpawnY(m_SpawnZone, Event->iSpawnPoint));
+		EnemyShip.Extent = EnemyExtent;
+		EnemyShip.fTimeTillNextShot = EnemyFireRate;
+		EnemyShip.Velocity = FVector2D(-Event->fVertSpeed, Event->fHorizSpeed);
+		m_Enemies.Add(EnemyShip);
+	}
+}
+
+void FHeadlessSimulation::UpdateShip(UNeuralNet* net, float deltaTime)
+{
+	m_Grid.Reset();
+	for (const FSSimBody& Destructible : m_Destructibles)
+	{
+		m_Grid.Mark(Destructible.Location.X, Destructible.Location.Y, m_Parameters->fDestValue);
+	}
+	for (const FSSimBody& Enemy : m_Enemies)
+	{
+		m_Grid.Mark(Enemy.Location.X, Enemy.Location.Y, m_Parameters->fEnemyValue);
+	}
+	for (const FSSimBody& Projectile : m_Projectiles)
+	{
+		if (Projectile.bEnemyProjectile)
+		{
+			m_Grid.Mark(Projectile.Location.X, Projectile.Location.Y, m_Parameters->fProjValue);
+		}
+	}
+
+	m_Inputs.Reset();
+	m_Grid.AppendInputs(m_Inputs, m_Ship.Location.Y);
+
+	//fire rate and life input, the life input keeps the integer division of the ship
+	m_Inputs.Add(1 - m_fShotCooldown / m_Parameters->fTimeBetweenShots);
+	m_Inputs.Add(m_iHealth == 1 ? 0.0 : double(m_iHealth / m_Parameters->iShipHealth));
+
+	TArray<double> Outputs = net->Update(m_Inputs, active);
+	if (Outputs.Num() < 3)
+	{
+		m_bFailed = true;
+		m_iHealth = 0;
+		return;
+	}
+
+	double MoveL = Outputs[0];
+	double MoveR = Outputs[1];
+	double Shoot = Outputs[2];
+
+	//use the highest output this step, ties do nothing
+	m_Ship.Velocity = FVector2D(0.f, 0.f);
+	if (MoveL > Shoot && MoveL > MoveR)
+	{
+		m_Ship.Velocity.Y = -ShipSpeed;
+	}
+	else if (MoveR > Shoot && MoveR > MoveL)
+	{
+		m_Ship.Velocity.Y = ShipSpeed;
+	}
+	else if (Shoot > MoveR && Shoot > MoveL && m_fShotCooldown <= 0.f)
+	{
+		FSSimBody Projectile;
+		Projectile.Location = m_Ship.Location + FVector2D(MuzzleDistance, 0.f);
+		Projectile.Velocity = FVector2D(ProjectileSpeed, 0.f);
+		Projectile.Extent = ProjectileExtent;
+		m_Projectiles.Add(Projectile);
+
+		m_fShotCooldown = m_Parameters->fTimeBetweenShots;
+		//shooting costs fitness
+		m_dFitness -= m_Parameters->fFitnessPerShot;
+	}
+
+	m_fShotCooldown -= deltaTime;
+	if (m_fShotCooldown < 0.f)
+	{
+		m_fShotCooldown = 0.f;
+	}
+}
+
+void FHeadlessSimulation::MovementReward()
+{
+	float NewYPos = m_Ship.Location.Y;
+	m_fNetDistanceMoved += NewYPos - m_fLastTickYPosition;
+	m_fLastTickYPosition = NewYPos;
+
+	if (FMath::Abs(m_fNetDistanceMoved) >= m_Parameters->fNetMovementRequired)
+	{
+		m_dFitness += m_Parameters->fMovementReward;
+		m_fNetDistanceMoved = 0.f;
+	}
+}
+
+void FHeadlessSimulation::MoveBodies(float deltaTime)
+{
+	//the walls of the level keep the ship on the play area
+	m_Ship.Location += m_Ship.Velocity * deltaTime;
+	m_Ship.Location.Y = FMath::Clamp(m_Ship.Location.Y, m_Grid.GetLeftY() + m_Ship.Extent.Y, m_Grid.GetRightY() - m_Ship.Extent.Y);
+
+	for (FSSimBody& Destructible : m_Destructibles)
+	{
+		Destructible.Location += Destructible.Velocity * deltaTime;
+	}
+
+	//enemies turn around near the border of the spawn zone and shoot on their own timer
+	float LeftY = m_SpawnZone.m_LeftY + 70.f;
+	float RightY = m_SpawnZone.m_RightY - 70.f;
+	for (FSSimBody& Enemy : m_Enemies)
+	{
+		if ((Enemy.Location.Y < LeftY) && (Enemy.Velocity.Y < 0.0f))
+		{
+			Enemy.Velocity.Y = -Enemy.Velocity.Y;
+		}
+		else if ((Enemy.Location.Y > RightY) && (Enemy.Velocity.Y > 0.0f))
+		{
+			Enemy.Velocity.Y = -Enemy.Velocity.Y;
+		}
+		Enemy.Location += Enemy.Velocity * deltaTime;
+
+		Enemy.fTimeTillNextShot -= deltaTime;
+		if (Enemy.fTimeTillNextShot < 0.0f)
+		{
+			FSSimBody Projectile;
+			Projectile.Location = Enemy.Location - FVector2D(MuzzleDistance, 0.f);
+			Projectile.Velocity = FVector2D(-ProjectileSpeed, 0.f);
+			Projectile.Extent = ProjectileExtent;
+			Projectile.bEnemyProjectile = true;
+			m_Projectiles.Add(Projectile);
+
+			Enemy.fTimeTillNextShot = EnemyFireRate;
+		}
+	}
+
+	for (FSSimBody& Projectile : m_Projectiles)
+	{
+		Projectile.Location += Projectile.Velocity * deltaTime;
+	}
+}
+
+void FHeadlessSimulation::ResolveHits()
+{
+	//like the OnHit of the actors any projectile destroys a destructible or an enemy and the player is rewarded
+	for (FSSimBody& Projectile : m_Projectiles)
+	{
+		for (FSSimBody& Destructible : m_Destructibles)
+		{
+			if (Projectile.bAlive && Destructible.bAlive && Overlap(Projectile, Destructible))
+			{
+				Projectile.bAlive = false;
+				Destructible.bAlive = false;
+				m_dFitness += m_Parameters->fFitnessRewardDestructible;
+			}
+		}
+		for (FSSimBody& Enemy : m_Enemies)
+		{
+			if (Projectile.bAlive && Enemy.bAlive && Overlap(Projectile, Enemy))
+			{
+				Projectile.bAlive = false;
+				Enemy.bAlive = false;
+				m_dFitness += m_Parameters->fFitnessRewardEnemy;
+			}
+		}
+	}
+
+	//whatever touches the ship is destroyed and costs a life
+	auto HitShip = [this](TArray<FSSimBody>& bodies)
+	{
+		for (FSSimBody& Body : bodies)
+		{
+			if (Body.bAlive && Overlap(m_Ship, Body))
+			{
+				Body.bAlive = false;
+				m_iHealth--;
+				m_dFitness -= m_Parameters->fFitnessPenaltyOnHit;
+			}
+		}
+	};
+	HitShip(m_Projectiles);
+	HitShip(m_Enemies);
+	HitShip(m_Destructibles);
+}
+
+void FHeadlessSimulation::RemoveDeadBodies()
+{
+	float MinX = m_Grid.GetBottomX() - CullMargin;
+	float MaxX = m_SpawnZone.m_UpX + CullMargin;
+	auto IsGone = [MinX, MaxX](const FSSimBody& Body)
+	{
+		return !Body.bAlive || Body.Location.X < MinX || Body.Location.X > MaxX;
+	};
+
+	m_Destructibles.RemoveAll(IsGone);
+	m_Enemies.RemoveAll(IsGone);
+	m_Projectiles.RemoveAll(IsGone);
+}
+
+bool FHeadlessSimulation::Overlap(const FSSimBody &a, const FSSimBody &b)
+{
+	return FMath::Abs(a.Location.X - b.Location.X) < a.Extent.X + b.Extent.X
+		&& FMath::Abs(a.Location.Y - b.Location.Y) < a.Extent.Y + b.Extent.Y;
+}
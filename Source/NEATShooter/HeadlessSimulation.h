@@ -0,0 +1,173 @@
+//Copyright 2018 Raphael Haucke
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+//http ://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+
+#pragma once
+
+#include "Globals.h"
+#include "NNInput.h"
+#include "Phenotype.h"
+#include "Scenario.h"
+
+#include "CoreMinimal.h"
+
+
+class UParameters;
+
+
+//Everything that moves in the headless simulation is a box in the XY plane, like the collision boxes of the actors
+struct FSSimBody
+{
+	FVector2D Location;
+	FVector2D Velocity;
+	FVector2D Extent;
+
+	//enemies only, counts down to the next shot
+	float fTimeTillNextShot;
+
+	//projectiles only, enemy projectiles are the ones the input grid shows
+	bool bEnemyProjectile;
+
+	//cleared on hits and when the body leaves the area, dead bodies are removed at the end of the step
+	bool bAlive;
+
+	FSSimBody() : Location(0.f, 0.f), Velocity(0.f, 0.f), Extent(0.f, 0.f), fTimeTillNextShot(0.f), bEnemyProjectile(false), bAlive(true) {}
+};
+
+//Everything a run of the headless simulation depends on at one moment. A run restored from it goes on exactly like the
+//original as long as the net acts the same
+struct FSSimSnapshot
+{
+	TArray<FSSimBody> Destructibles;
+	TArray<FSSimBody> Enemies;
+	TArray<FSSimBody> Projectiles;
+
+	FSSimBody Ship;
+	int iHealth;
+	double dFitness;
+	float fShotCooldown;
+	float fNetDistanceMoved;
+	float fLastTickYPosition;
+	float fTimePlayed;
+
+	const FScenario* Scenario;
+	FSScenarioCursor Cursor;
+
+	//the recurrent state of the net that played up to here
+	TArray<FSNeuronActivation> NetActivations;
+
+	FSSimSnapshot() : iHealth(0), dFitness(0.0), fShotCooldown(0.f), fNetDistanceMoved(0.f), fLastTickYPosition(0.f), fTimePlayed(0.f), Scenario(nullptr) {}
+
+	int GetNumBodies() const { return Destructibles.Num() + Enemies.Num() + Projectiles.Num(); }
+};
+
+//The game of AMyGameMode without the engine: spawn timers, movement, enemy fire, hits, rewards and penalties of the actors,
+//played by one net with a fixed time step. The enemies come from the scenario of the run, so a run is
+//reproducible and a lot faster than real time. Nothing in here touches the world, the net is the only UObject used
+class NEATSHOOTER_API FHeadlessSimulation
+{
+private:
+	const UParameters* m_Parameters;
+
+	//the same encoding UNNInput gives the nets in the level
+	FNNInputGrid m_Grid;
+
+	FSpawnZone m_SpawnZone;
+	FVector2D m_PlayerStartPosition;
+
+	//the scenario of the current run and how far it has been played
+	const FScenario* m_Scenario;
+	FSScenarioCursor m_Cursor;
+
+	TArray<FSSimBody> m_Destructibles;
+	TArray<FSSimBody> m_Enemies;
+	TArray<FSSimBody> m_Projectiles;
+
+	//the player ship
+	FSSimBody m_Ship;
+	int m_iHealth;
+	double m_dFitness;
+	float m_fShotCooldown;
+	float m_fNetDistanceMoved;
+	float m_fLastTickYPosition;
+
+	float m_fTimePlayed;
+
+	//reused every step
+	TArray<double> m_Inputs;
+
+	//set when the net could not play the run. Runs may be on worker threads, so the caller reports it on the game thread
+	bool m_bFailed;
+
+
+
+	//Spawn the events of the scenario that are due
+	void SpawnDestructibleOnTimer(float deltaTime);
+	void SpawnEnemySpaceshipOnTimer(float deltaTime);
+
+	//Lets the net pick this step's action, like ANNSpaceShip::Update
+	void UpdateShip(UNeuralNet* net, float deltaTime);
+
+	//Like ANNSpaceShip::MovementReward
+	void MovementReward();
+
+	void MoveBodies(float deltaTime);
+	void ResolveHits();
+
+	//Removes bodies that were hit or left the area
+	void RemoveDeadBodies();
+
+	static bool Overlap(const FSSimBody &a, const FSSimBody &b);
+
+public:
+	//the level values the simulation copies, kept in one place
+	static const float ShipSpeed;
+	static const float ProjectileSpeed;
+	static const float EnemyFireRate;
+	static const float MuzzleDistance;
+	//bodies this far outside the area are gone for good
+	static const float CullMargin;
+
+	FHeadlessSimulation();
+
+	//The grid brings the dimensions of the play area with it
+	void Initialize(const UParameters* parameters, const FNNInputGrid &grid, const FSpawnZone &spawnZone, FVector2D playerStartPosition);
+
+	//Starts a new run of the scenario, which has to outlive the run, with the activations of the net cleared. Runs of the
+	//same net in the same scenario play out the same way
+	void Reset(const FScenario &scenario, UNeuralNet* net);
+
+	//Advances the run by one step with the net controlling the ship. Returns false once the run is over
+	bool Step(UNeuralNet* net, float deltaTime);
+
+	//Plays a whole run with the fixed time step of the parameters and returns the fitness. Shows nothing on screen, the caller
+	//checks fHeadlessTimeStep and HasFailed on the game thread
+	double Run(UNeuralNet* net, const FScenario &scenario);
+
+	//Same end conditions as AMyGameMode::UpdateTraining
+	bool IsFinished() const;
+
+	//Copies the state of the run and the activations of the net playing it
+	void CaptureState(FSSimSnapshot &outSnapshot, const UNeuralNet* net) const;
+	//Continues a captured run with the net. Neurons the net doesn't share with the captured one start without activation
+	void RestoreState(const FSSimSnapshot &snapshot, UNeuralNet* net);
+	//Plays the net from the state for the seconds or until the run ends and returns the fitness it gained. Errors like Run
+	double RunFork(UNeuralNet* net, const FSSimSnapshot &snapshot, float duration);
+
+	int GetNumBodies() const { return m_Destructibles.Num() + m_Enemies.Num() + m_Projectiles.Num(); }
+
+	double GetFitness() const { return m_dFitness; }
+	int GetHealth() const { return m_iHealth; }
+	float GetTimePlayed() const { return m_fTimePlayed; }
+	bool HasFailed() const { return m_bFailed; }
+};
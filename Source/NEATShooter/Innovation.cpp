@@ -13,18 +13,21 @@
 //limitations under the License.
 
 #include "Innovation.h"
+#include "Genotype.h"
 
 
 
 
 UInnovation::UInnovation()
 {
+	m_NextNeuronID = 0;
+	m_NextInnovationID = 0;
+	m_bStaging = false;
 }
 
 void UInnovation::Initialize(TArray<FSLinkGene> startLinks, TArray<FSNeuronGene> startNeurons)
 {
-	m_NextNeuronID = 0;
-	m_NextInnovationID = 0;
+	Clear();
 
 	//add the neurons
 	for (FSNeuronGene curNeuron : startNeurons)
@@ -39,56 +42,323 @@ void UInnovation::Initialize(TArray<FSLinkGene> startLinks, TArray<FSNeuronGene>
 	}
 }
 
+uint64 UInnovation::MakeKey(int fromNeuron, int toNeuron, innovation_type type)
+{
+	//neuron IDs are never bigger than 31 bits, so the top bit is free for the type
+	return ((uint64)type << 63) | ((uint64)(uint32)fromNeuron << 32) | (uint64)(uint32)toNeuron;
+}
+
+FSInnovationShard& UInnovation::GetShard(uint64 key)
+{
+	return m_Shards[GetTypeHash(key) % NumShards];
+}
+
+int UInnovation::AddInnovation(FSInnovation &innovation, bool bNewNeuron)
+{
+	FScopeLock ListLock(&m_ListLock);
+
+	innovation.InnovationID = m_NextInnovationID;
+	m_Innovations.Add(innovation);
+
+	if (bNewNeuron)
+	{
+		m_NeuronLookup.Add(innovation.NeuronID, innovation.InnovationID);
+		++m_NextNeuronID;
+	}
+
+	return m_NextInnovationID++;
+}
+
 int UInnovation::CheckForInnovation(int fromNeuron, int toNeuron, innovation_type type)
 {
-	for (FSInnovation curInnovation : m_Innovations)
+	uint64 Key = MakeKey(fromNeuron, toNeuron, type);
+	FSInnovationShard& Shard = GetShard(Key);
+	FScopeLock ShardLock(&Shard.Lock);
+
+	const int* InnovationID = Shard.Lookup.Find(Key);
+	if (InnovationID)
 	{
-		if (curInnovation.InnovationType == type)
-		{
-			if (curInnovation.ToNeuron == toNeuron)
-			{
-				if (curInnovation.FromNeuron == fromNeuron)
-				{
-					return curInnovation.InnovationID;
-				}
-			}
-		}
+		return *InnovationID;
 	}
 	return -1;
 }
 
 int UInnovation::CreateNewLinkInnovation(int fromNeuron, int toNeuron)
 {
-	FSInnovation NewInnov = FSInnovation(fromNeuron, toNeuron, m_NextInnovationID);
-	m_Innovations.Add(NewInnov);
+	uint64 Key = MakeKey(fromNeuron, toNeuron, new_link);
+	FSInnovationShard& Shard = GetShard(Key);
+	FScopeLock ShardLock(&Shard.Lock);
 
-	return m_NextInnovationID++;
+	FSInnovation NewInnov = FSInnovation(fromNeuron, toNeuron, -1);
+	int InnovationID = AddInnovation(NewInnov, false);
+
+	//the first innovation for a pair of neurons is the one lookups return
+	if (!Shard.Lookup.Contains(Key))
+	{
+		Shard.Lookup.Add(Key, InnovationID);
+	}
+
+	return InnovationID;
 }
 
 int UInnovation::CreateNewNeuronInnovation(FSNeuronGene &newNeuronGene, int fromNeuron, int toNeuron)
 {
-	FSInnovation NewInnov = FSInnovation(newNeuronGene, m_NextInnovationID, fromNeuron, toNeuron);
-	m_Innovations.Add(NewInnov);
-	++m_NextNeuronID;
+	FSInnovation NewInnov = FSInnovation(newNeuronGene, -1, fromNeuron, toNeuron);
 
-	return m_NextInnovationID++;
+	//start neurons all have -1 as from and to neuron, they are found through their neuron ID only
+	if (fromNeuron < 0 || toNeuron < 0)
+	{
+		return AddInnovation(NewInnov, true);
+	}
+
+	uint64 Key = MakeKey(fromNeuron, toNeuron, new_neuron);
+	FSInnovationShard& Shard = GetShard(Key);
+	FScopeLock ShardLock(&Shard.Lock);
+
+	int InnovationID = AddInnovation(NewInnov, true);
+
+	if (!Shard.Lookup.Contains(Key))
+	{
+		Shard.Lookup.Add(Key, InnovationID);
+	}
+
+	return InnovationID;
 }
 
-FSNeuronGene UInnovation::CreateNeuronFromID(int neuronID)
+int UInnovation::FindOrCreateLinkInnovation(int fromNeuron, int toNeuron)
+{
+	uint64 Key = MakeKey(fromNeuron, toNeuron, new_link);
+	FSInnovationShard& Shard = GetShard(Key);
+	FScopeLock ShardLock(&Shard.Lock);
+
+	const int* ExistingID = Shard.Lookup.Find(Key);
+	if (ExistingID)
+	{
+		return *ExistingID;
+	}
+
+	FSInnovation NewInnov = FSInnovation(fromNeuron, toNeuron, -1);
+	int InnovationID = AddInnovation(NewInnov, false);
+	Shard.Lookup.Add(Key, InnovationID);
+
+	return InnovationID;
+}
+
+void UInnovation::CreateNeuronWithLinks(int fromNeuron, int toNeuron, double splitX, double splitY, int &neuronID, int &linkInID, int &linkOutID)
+{
+	uint64 Key = MakeKey(fromNeuron, toNeuron, new_neuron);
+	FSInnovationShard& Shard = GetShard(Key);
+
+	{
+		FScopeLock ShardLock(&Shard.Lock);
+		//the neuron ID has to be taken under the list lock, otherwise two threads could create the same neuron
+		FScopeLock ListLock(&m_ListLock);
+
+		neuronID = m_NextNeuronID;
+		FSNeuronGene NewNeuronGene = FSNeuronGene(hidden, neuronID, splitX, splitY);
+		FSInnovation NewInnov = FSInnovation(NewNeuronGene, -1, fromNeuron, toNeuron);
+		int InnovationID = AddInnovation(NewInnov, true);
+
+		if (!Shard.Lookup.Contains(Key))
+		{
+			Shard.Lookup.Add(Key, InnovationID);
+		}
+	}
+
+	//the neuron is new so its links can't exist yet
+	linkInID = CreateNewLinkInnovation(fromNeuron, neuronID);
+	linkOutID = CreateNewLinkInnovation(neuronID, toNeuron);
+}
+
+void UInnovation::FindOrCreateNeuronInnovation(UGenome* genome, int fromNeuron, int toNeuron, double splitX, double splitY, int &neuronID, int &linkInID, int &linkOutID)
 {
-	FSNeuronGene NeuronGene = FSNeuronGene();
+	int InnovationID = CheckForInnovation(fromNeuron, toNeuron, new_neuron);
 
-	for (FSInnovation curInnovation : m_Innovations)
+	//If innovation already exists check if the neuronID of that innovation is already used by the genome
+	if (InnovationID >= 0)
 	{
-		if (curInnovation.InnovationType == new_neuron)
+		neuronID = GetNeuronID(InnovationID);
+
+		if (!genome->GenomeAlreadyHasNeuronID(neuronID))
 		{
-			if (curInnovation.NeuronID == neuronID)
+			//since the neuron innovation already took place we should also have the 2 link innovations
+			linkInID = CheckForInnovation(fromNeuron, neuronID, new_link);
+			linkOutID = CheckForInnovation(neuronID, toNeuron, new_link);
+
+			if ((linkInID < 0) || (linkOutID < 0))
 			{
-				NeuronGene = FSNeuronGene(curInnovation.NeuronType, neuronID, curInnovation.dSplitX, curInnovation.dSplitY);
-				return NeuronGene;
+				GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("Innovation FindOrCreateNeuronInnovation missing link innovation"));
 			}
+			return;
 		}
 	}
+
+	//if yes we need a new innovation
+	CreateNeuronWithLinks(fromNeuron, toNeuron, splitX, splitY, neuronID, linkInID, linkOutID);
+}
+
+FSNeuronGene UInnovation::CreateNeuronFromID(int neuronID)
+{
+	FScopeLock ListLock(&m_ListLock);
+
+	const int* InnovationID = m_NeuronLookup.Find(neuronID);
+	if (InnovationID)
+	{
+		const FSInnovation& curInnovation = m_Innovations[*InnovationID];
+		return FSNeuronGene(curInnovation.NeuronType, neuronID, curInnovation.dSplitX, curInnovation.dSplitY);
+	}
+
 	GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("Innovation CreateNeuronFromID Couldn't create neuron from innovation list"));
-	return NeuronGene;
+	return FSNeuronGene();
+}
+
+int UInnovation::GetNeuronID(int innovationID) const
+{
+	FScopeLock ListLock(&m_ListLock);
+	return m_Innovations[innovationID].NeuronID;
+}
+
+void UInnovation::BeginStaging()
+{
+	m_bStaging = true;
+}
+
+void UInnovation::ResolveStagedInnovations(const TArray<UGenome*> &children)
+{
+	m_bStaging = false;
+
+	//provisional -> real IDs, per child
+	TMap<int, int> NeuronRemap;
+	TMap<int, int> LinkRemap;
+
+	for (UGenome* curChild : children)
+	{
+		if (curChild->GetPendingInnovations().Num() == 0)
+		{
+			continue;
+		}
+
+		NeuronRemap.Reset();
+		LinkRemap.Reset();
+
+		for (const FSInnovationProposal& curProposal : curChild->GetPendingInnovations())
+		{
+			//the proposal may build on neurons proposed earlier by the same child
+			const int* MappedFrom = NeuronRemap.Find(curProposal.FromNeuron);
+			const int* MappedTo = NeuronRemap.Find(curProposal.ToNeuron);
+			int FromNeuronID = MappedFrom ? *MappedFrom : curProposal.FromNeuron;
+			int ToNeuronID = MappedTo ? *MappedTo : curProposal.ToNeuron;
+
+			if (curProposal.bNewNeuron)
+			{
+				int NeuronID, LinkInID, LinkOutID;
+				FindOrCreateNeuronInnovation(curChild, FromNeuronID, ToNeuronID, curProposal.dSplitX, curProposal.dSplitY, NeuronID, LinkInID, LinkOutID);
+
+				NeuronRemap.Add(curProposal.NeuronID, NeuronID);
+				LinkRemap.Add(curProposal.LinkID, LinkInID);
+				LinkRemap.Add(curProposal.SecondLinkID, LinkOutID);
+			}
+			else
+			{
+				LinkRemap.Add(curProposal.LinkID, FindOrCreateLinkInnovation(FromNeuronID, ToNeuronID));
+			}
+		}
+
+		//rewrites the genes, drops the proposals and sorts the genes again
+		curChild->ResolveProvisionalIDs(NeuronRemap, LinkRemap);
+	}
+}
+
+void UInnovation::ImportGenome(UGenome* genome, const UInnovation &source)
+{
+	TMap<int, int> NeuronRemap;
+	TMap<int, int> LinkRemap;
+	TSet<int> UsedNeurons;
+
+	for (const FSNeuronGene &curNeuron : genome->GetNeuronGenesList())
+	{
+		ImportNeuron(curNeuron.iID, source, NeuronRemap, UsedNeurons);
+	}
+
+	for (const FSLinkGene &curLink : genome->GetLinkGenesList())
+	{
+		int FromNeuronID = ImportNeuron(curLink.FromNeuron, source, NeuronRemap, UsedNeurons);
+		int ToNeuronID = ImportNeuron(curLink.ToNeuron, source, NeuronRemap, UsedNeurons);
+		LinkRemap.Add(curLink.iInnovationID, FindOrCreateLinkInnovation(FromNeuronID, ToNeuronID));
+	}
+
+	genome->ResolveProvisionalIDs(NeuronRemap, LinkRemap);
+}
+
+int UInnovation::ImportNeuron(int sourceNeuronID, const UInnovation &source, TMap<int, int> &neuronRemap, TSet<int> &usedNeurons)
+{
+	if (const int* MappedID = neuronRemap.Find(sourceNeuronID))
+	{
+		return *MappedID;
+	}
+
+	FSInnovation SourceInnovation;
+	if (!source.FindNeuronInnovation(sourceNeuronID, SourceInnovation))
+	{
+		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("Innovation ImportNeuron neuron missing in source innovation list"));
+		neuronRemap.Add(sourceNeuronID, sourceNeuronID);
+		return sourceNeuronID;
+	}
+
+	int NeuronID = sourceNeuronID;
+
+	//start neurons have the same IDs in every list
+	if (SourceInnovation.FromNeuron >= 0 && SourceInnovation.ToNeuron >= 0)
+	{
+		//the neurons of the split link first, they may be hidden neurons themselves
+		int FromNeuronID = ImportNeuron(SourceInnovation.FromNeuron, source, neuronRemap, usedNeurons);
+		int ToNeuronID = ImportNeuron(SourceInnovation.ToNeuron, source, neuronRemap, usedNeurons);
+
+		int InnovationID = CheckForInnovation(FromNeuronID, ToNeuronID, new_neuron);
+		if (InnovationID >= 0 && !usedNeurons.Contains(GetNeuronID(InnovationID)))
+		{
+			NeuronID = GetNeuronID(InnovationID);
+		}
+		//unknown here, or the genome split the same link twice
+		else
+		{
+			int LinkInID, LinkOutID;
+			CreateNeuronWithLinks(FromNeuronID, ToNeuronID, SourceInnovation.dSplitX, SourceInnovation.dSplitY, NeuronID, LinkInID, LinkOutID);
+		}
+	}
+
+	neuronRemap.Add(sourceNeuronID, NeuronID);
+	usedNeurons.Add(NeuronID);
+	return NeuronID;
+}
+
+bool UInnovation::FindNeuronInnovation(int neuronID, FSInnovation &outInnovation) const
+{
+	FScopeLock ListLock(&m_ListLock);
+
+	const int* InnovationID = m_NeuronLookup.Find(neuronID);
+	if (!InnovationID)
+	{
+		return false;
+	}
+	outInnovation = m_Innovations[*InnovationID];
+	return true;
+}
+
+void UInnovation::Clear()
+{
+	//shards are always locked before the list
+	for (int i = 0; i < NumShards; ++i)
+	{
+		FScopeLock ShardLock(&m_Shards[i].Lock);
+		m_Shards[i].Lookup.Empty();
+	}
+
+	FScopeLock ListLock(&m_ListLock);
+
+	m_Innovations.Empty();
+	m_NeuronLookup.Empty();
+	m_NextNeuronID = 0;
+	m_NextInnovationID = 0;
+	m_bStaging = false;
 }
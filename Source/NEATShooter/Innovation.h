@@ -69,7 +69,16 @@ struct FSInnovation
 
 };
 
-//The Innovation List Class. Keeps track of all innovations created during the evolution of the population
+//One shard of the innovation lookup. Innovations are spread over the shards by their from/to neurons so concurrent lookups rarely share a lock
+struct FSInnovationShard
+{
+	FCriticalSection Lock;
+	TMap<uint64, int> Lookup;
+};
+
+//The Innovation List Class. Keeps track of all innovations created during the evolution of the population.
+//Lookups and insertions are thread safe. While staging, genomes only propose new innovations and the IDs are handed out
+//in child order by ResolveStagedInnovations, so the result doesn't depend on how the mutations were scheduled
 UCLASS()
 class NEATSHOOTER_API UInnovation : public UObject
 {
@@ -77,13 +86,42 @@ class NEATSHOOTER_API UInnovation : public UObject
 	
 private:
 	UPROPERTY()
-		//list of all the innovations, first are the startneurons, then the startlinks
+		//list of all the innovations, first are the startneurons, then the startlinks. The index of an innovation is its ID
 		TArray<FSInnovation> m_Innovations;
 
 	//keeps track of the IDs new innovations need
 	int m_NextNeuronID;
 	int m_NextInnovationID;
 
+	//true between BeginStaging and ResolveStagedInnovations
+	bool m_bStaging;
+
+	static const int NumShards = 16;
+
+	//(type, fromNeuron, toNeuron) -> innovationID
+	FSInnovationShard m_Shards[NumShards];
+
+	//neuronID -> innovationID of the neuron
+	TMap<int, int> m_NeuronLookup;
+
+	//guards m_Innovations, m_NeuronLookup and the ID counters
+	mutable FCriticalSection m_ListLock;
+
+
+
+	static uint64 MakeKey(int fromNeuron, int toNeuron, innovation_type type);
+	FSInnovationShard& GetShard(uint64 key);
+
+	//Appends the innovation under the list lock and returns its ID. Callers hold the lock of the shard the innovation belongs to
+	int AddInnovation(FSInnovation &innovation, bool bNewNeuron);
+
+	//Creates the neuron innovation splitting fromNeuron -> toNeuron plus its two link innovations
+	void CreateNeuronWithLinks(int fromNeuron, int toNeuron, double splitX, double splitY, int &neuronID, int &linkInID, int &linkOutID);
+
+	//Returns the ID in this list of a neuron from the source list, creating the innovations it needs. usedNeurons are
+	//the neurons of this list the imported genome already has
+	int ImportNeuron(int sourceNeuronID, const UInnovation &source, TMap<int, int> &neuronRemap, TSet<int> &usedNeurons);
+
 public:
 	UInnovation();
 	void Initialize(TArray<FSLinkGene> startLinks, TArray<FSNeuronGene> startNeurons);
@@ -98,13 +136,34 @@ public:
 	//From and ToNeuron IDs of Input neurons are set to - 1 as another way to identify those
 	int CreateNewNeuronInnovation(FSNeuronGene &neuronGene, int fromNeuron = -1, int toNeuron = -1);
 
+	//Returns the ID of the link innovation, creates it if it doesn't exist yet. Lookup and insertion happen under one lock
+	int FindOrCreateLinkInnovation(int fromNeuron, int toNeuron);
+
+	//Returns the IDs for a neuron splitting fromNeuron -> toNeuron. An existing innovation is reused unless the genome
+	//already has its neuron, otherwise a new neuron innovation and its two links are created
+	void FindOrCreateNeuronInnovation(UGenome* genome, int fromNeuron, int toNeuron, double splitX, double splitY, int &neuronID, int &linkInID, int &linkOutID);
+
 	//Looks for the passed neuronID in the innovation list then creates and returns a copy of this neuron
 	FSNeuronGene CreateNeuronFromID(int neuronID);
 
+	//From now on genomes propose new innovations instead of creating them
+	void BeginStaging();
+
+	//Assigns real IDs to the proposals of the children in array order, rewrites the provisional IDs in the children and ends staging
+	void ResolveStagedInnovations(const TArray<UGenome*> &children);
+
+	//Rewrites a genome that evolved with the source list to the IDs of this list. Hidden neurons are matched by the link
+	//they split, links by their neurons. Innovations this list doesn't know yet are created
+	void ImportGenome(UGenome* genome, const UInnovation &source);
+
+	//Copies the innovation that created the neuron into outInnovation, returns false if the neuron is unknown
+	bool FindNeuronInnovation(int neuronID, FSInnovation &outInnovation) const;
+
 
 
-	int GetNeuronID(int innovationID) const { return m_Innovations[innovationID].NeuronID; }
-	void Clear() { m_Innovations.Empty(); return; }
+	bool IsStaging() const { return m_bStaging; }
+	int GetNeuronID(int innovationID) const;
+	void Clear();
 	int GetNextInnovationID() { return m_NextInnovationID; }
 	int GetNextNeuronID() { return m_NextNeuronID; }
 };
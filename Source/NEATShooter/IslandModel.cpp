@@ -0,0 +1,271 @@
+//Copyright 2018 Raphael Haucke
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+//http ://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+
+#include "IslandModel.h"
+#include "GeneticAlgorithm.h"
+#include "Genotype.h"
+#include "Parameters.h"
+#include "MyGameMode.h"
+
+
+
+UIslandModel::UIslandModel()
+{
+}
+
+void UIslandModel::Initialize(int numIslands, int populationSize, int numInputs, int numOutputs, AMyGameMode* gameMode)
+{
+	m_GameMode = gameMode;
+	m_Parameters = m_GameMode->GetParameters();
+	m_iMigrations = 0;
+	m_iSteppingIsland = -1;
+
+	int NextGenome = 0;
+
+	for (int i = 0; i < numIslands; ++i)
+	{
+		//the first islands get the remainder
+		int IslandSize = populationSize / numIslands + ((i < populationSize % numIslands) ? 1 : 0);
+
+		UGeneticAlgorithm* Island = NewObject<UGeneticAlgorithm>(this);
+		Island->Initialize(IslandSize, numInputs, numOutputs, m_GameMode);
+		Island->SetIsland(i);
+
+		m_Islands.Add(Island);
+		m_FirstGenome.Add(NextGenome);
+		NextGenome += IslandSize;
+	}
+	m_FirstGenome.Add(NextGenome);
+}
+
+TArray<UNeuralNet*> UIslandModel::Epoch(TArray<double> &fitnessScores)
+{
+	BeginEpoch(fitnessScores);
+	StepEpoch(0.0);
+	return FinishEpoch();
+}
+
+void UIslandModel::BeginEpoch(const TArray<double> &fitnessScores)
+{
+	m_IslandScores.Reset();
+	m_IslandScores.SetNum(m_Islands.Num());
+
+	for (int i = 0; i < m_Islands.Num(); ++i)
+	{
+		m_IslandScores[i].Append(fitnessScores.GetData() + m_FirstGenome[i], m_FirstGenome[i + 1] - m_FirstGenome[i]);
+	}
+
+	//immigrants arrive before the epoch so they compete with their fitness from home
+	if ((m_Parameters->iMigrationInterval > 0) && (GetGeneration() % m_Parameters->iMigrationInterval == 0))
+	{
+		Migrate(m_IslandScores);
+	}
+
+	m_NewNetworks.Empty();
+	m_iSteppingIsland = 0;
+	m_Islands[0]->BeginEpoch(m_IslandScores[0]);
+}
+
+bool UIslandModel::StepEpoch(double budgetSeconds)
+{
+	const double Deadline = FPlatformTime::Seconds() + budgetSeconds;
+
+	//the epochs create UObjects, so the islands take turns on the game thread. Each epoch spreads its stages over the task graph
+	while (m_iSteppingIsland < m_Islands.Num())
+	{
+		double Remaining = (budgetSeconds > 0.0) ? FMath::Max(Deadline - FPlatformTime::Seconds(), 0.0) : 0.0;
+		if ((budgetSeconds > 0.0) && (Remaining <= 0.0))
+		{
+			return false;
+		}
+
+		if (!m_Islands[m_iSteppingIsland]->StepEpoch(Remaining))
+		{
+			return false;
+		}
+
+		m_NewNetworks.Append(m_Islands[m_iSteppingIsland]->FinishEpoch());
+		++m_iSteppingIsland;
+
+		if (m_iSteppingIsland < m_Islands.Num())
+		{
+			m_Islands[m_iSteppingIsland]->BeginEpoch(m_IslandScores[m_iSteppingIsland]);
+		}
+	}
+
+	return true;
+}
+
+TArray<UNeuralNet*> UIslandModel::FinishEpoch()
+{
+	m_iSteppingIsland = -1;
+
+	TArray<UNeuralNet*> NewNetworks = MoveTemp(m_NewNetworks);
+	m_NewNetworks.Empty();
+	return NewNetworks;
+}
+
+void UIslandModel::Migrate(TArray<TArray<double>> &fitnessScores)
+{
+	const int NumIslands = m_Islands.Num();
+	if (NumIslands < 2)
+	{
+		return;
+	}
+
+	FRandomStream Rng(HashCombine(GetTypeHash(m_Parameters->iRandomSeed), GetTypeHash(m_iMigrations)));
+	++m_iMigrations;
+
+	//genome indices of every island, best first
+	TArray<TArray<int>> Ranked;
+	Ranked.SetNum(NumIslands);
+	for (int i = 0; i < NumIslands; ++i)
+	{
+		for (int j = 0; j < fitnessScores[i].Num(); ++j)
+		{
+			Ranked[i].Add(j);
+		}
+		const TArray<double> &Scores = fitnessScores[i];
+		Ranked[i].StableSort([&Scores](int lhs, int rhs) { return Scores[lhs] > Scores[rhs]; });
+	}
+
+	//all emigrants are picked before anyone arrives, so an immigrant never moves on in the same migration
+	struct FSMigration
+	{
+		int FromIsland;
+		int ToIsland;
+		int FromGenome;
+		int ToGenome;
+		double Fitness;
+	};
+	TArray<FSMigration> Migrations;
+
+	//how many of the worst slots of each island are already taken by immigrants
+	TArray<int> NumArrived;
+	NumArrived.SetNumZeroed(NumIslands);
+
+	for (int From = 0; From < NumIslands; ++From)
+	{
+		int To = (From + 1) % NumIslands;
+		if (m_Parameters->bRandomMigration)
+		{
+			To = (From + RandInt(Rng, 1, NumIslands - 1)) % NumIslands;
+		}
+
+		//never replace more than half of the receiving island, emigrants come from the better half
+		int Receivable = Ranked[To].Num() / 2 - NumArrived[To];
+		int NumMigrants = FMath::Min(FMath::Min(m_Parameters->iNumMigrants, Ranked[From].Num() / 2), Receivable);
+
+		for (int i = 0; i < NumMigrants; ++i)
+		{
+			FSMigration Migration;
+			Migration.FromIsland = From;
+			Migration.ToIsland = To;
+			Migration.FromGenome = Ranked[From][i];
+			Migration.ToGenome = Ranked[To][Ranked[To].Num() - 1 - NumArrived[To]];
+			Migration.Fitness = fitnessScores[From][Migration.FromGenome];
+			Migrations.Add(Migration);
+
+			++NumArrived[To];
+		}
+	}
+
+	//the emigrants are looked up before any slot is overwritten
+	TArray<UGenome*> Emigrants;
+	for (const FSMigration &Migration : Migrations)
+	{
+		Emigrants.Add(m_Islands[Migration.FromIsland]->GetGenome(Migration.FromGenome));
+	}
+
+	for (int i = 0; i < Migrations.Num(); ++i)
+	{
+		const FSMigration &Migration = Migrations[i];
+		UGeneticAlgorithm* Source = m_Islands[Migration.FromIsland];
+		UGeneticAlgorithm* Target = m_Islands[Migration.ToIsland];
+
+		Target->ImportMigrant(Migration.ToGenome, Emigrants[i], *Source->GetInnovation());
+		fitnessScores[Migration.ToIsland][Migration.ToGenome] = Migration.Fitness;
+	}
+}
+
+UGeneticAlgorithm* UIslandModel::GetBestIsland()
+{
+	UGeneticAlgorithm* BestIsland = m_Islands[0];
+
+	for (UGeneticAlgorithm* island : m_Islands)
+	{
+		if (island->GetBestEverFitness() > BestIsland->GetBestEverFitness())
+		{
+			BestIsland = island;
+		}
+	}
+	return BestIsland;
+}
+
+TArray<UGenome*> UIslandModel::GetGenotypes()
+{
+	TArray<UGenome*> Genotypes;
+	for (UGeneticAlgorithm* island : m_Islands)
+	{
+		Genotypes.Append(island->GetGenotypes());
+	}
+	return Genotypes;
+}
+
+TArray<UNeuralNet*> UIslandModel::GetLastGenerationsBestPhenotypes()
+{
+	return GetBestIsland()->GetLastGenerationsBestPhenotypes();
+}
+
+UNeuralNet* UIslandModel::GetBestPhenotype()
+{
+	return GetBestIsland()->GetBestPhenotype();
+}
+
+FString UIslandModel::GetGenomeStats()
+{
+	UGeneticAlgorithm* BestIsland = GetBestIsland();
+	FString Stats;
+
+	for (UGeneticAlgorithm* island : m_Islands)
+	{
+		FString IslandStats = island->GetGenomeStats();
+		if (island == BestIsland)
+		{
+			Stats = IslandStats;
+		}
+	}
+	return Stats;
+}
+
+int UIslandModel::GetNumSpecies()
+{
+	int NumSpecies = 0;
+	for (UGeneticAlgorithm* island : m_Islands)
+	{
+		NumSpecies += island->GetNumSpecies();
+	}
+	return NumSpecies;
+}
+
+int UIslandModel::GetGeneration()
+{
+	//the last island is the last to finish an epoch
+	return m_Islands.Last()->GetGeneration();
+}
+
+TArray<FSplitDepth> UIslandModel::GetFSplitDepthLookupTable()
+{
+	return m_Islands[0]->GetFSplitDepthLookupTable();
+}
@@ -0,0 +1,95 @@
+//Copyright 2018 Raphael Haucke
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+//http ://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+
+#pragma once
+
+#include "Globals.h"
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "IslandModel.generated.h"
+
+
+class UGeneticAlgorithm;
+class UNeuralNet;
+class UGenome;
+class AMyGameMode;
+class UParameters;
+
+
+//Splits the population into islands, each a UGeneticAlgorithm with its own innovation list and random streams.
+//The islands only meet when the best genomes of each island migrate to another one every iMigrationInterval generations.
+//The ships play the genomes of all islands in island order, so the game mode sees one population
+UCLASS()
+class NEATSHOOTER_API UIslandModel : public UObject
+{
+	GENERATED_BODY()
+
+private:
+	UPROPERTY()
+		AMyGameMode* m_GameMode;
+
+	UPROPERTY()
+		UParameters* m_Parameters;
+
+	UPROPERTY()
+		TArray<UGeneticAlgorithm*> m_Islands;
+
+	//index of the first genome of each island in the whole population
+	TArray<int> m_FirstGenome;
+
+	//number of migrations so far, seeds the random topology
+	int m_iMigrations;
+
+	//island whose epoch is in progress, its scores and the nets of the islands that are done
+	int m_iSteppingIsland;
+	TArray<TArray<double>> m_IslandScores;
+	UPROPERTY()
+		TArray<UNeuralNet*> m_NewNetworks;
+
+
+
+	//Moves copies of the best genomes of each island to another island, where they replace the worst ones.
+	//fitnessScores are the scores of each island and get the fitness of the immigrants
+	void Migrate(TArray<TArray<double>> &fitnessScores);
+
+	//Returns the island that found the best genome so far
+	UGeneticAlgorithm* GetBestIsland();
+
+public:
+	UIslandModel();
+
+	//Creates numIslands populations that share populationSize between them
+	void Initialize(int numIslands, int populationSize, int numInputs, int numOutputs, AMyGameMode* gameMode);
+
+	//Runs an epoch on every island with its part of the scores and returns the new nets of all islands
+	TArray<UNeuralNet*> Epoch(TArray<double> &fitnessScores);
+
+	//Same as UGeneticAlgorithm, the islands are stepped one after the other
+	void BeginEpoch(const TArray<double> &fitnessScores);
+	bool StepEpoch(double budgetSeconds);
+	TArray<UNeuralNet*> FinishEpoch();
+	bool IsEpochRunning() const { return m_iSteppingIsland >= 0; }
+
+	TArray<UGenome*> GetGenotypes();
+	TArray<UNeuralNet*> GetLastGenerationsBestPhenotypes();
+	UNeuralNet* GetBestPhenotype();
+
+	//Stats of the island with the best genome. The other islands' counters are reset as well
+	FString GetGenomeStats();
+
+	int GetNumSpecies();
+	int GetGeneration();
+	TArray<FSplitDepth> GetFSplitDepthLookupTable();
+};
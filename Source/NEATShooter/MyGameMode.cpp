@@ -21,6 +21,7 @@
 #include "Engine/World.h"
 #include "UnrealMathUtility.h"
 #include "GeneticAlgorithm.h"
+#include "IslandModel.h"
 #include "NNInput.h"
 #include "NNSpaceShip.h"
 #include "Phenotype.h"
@@ -29,6 +30,7 @@
 #include "Parameters.h"
 #include "PlayerEndboss.h"
 #include "Kismet/GameplayStatics.h"
+#include "GameFramework/PawnMovementComponent.h"
 
 
 
@@ -45,48 +47,66 @@ void AMyGameMode::BeginPlay()
 
 	m_Parameters = NewObject<UParameters>(this);
 
-	m_InputProvider = NewObject<UNNInput>(this);
-	m_InputProvider->Initialize(this);
+	m_SpawnZone = FSpawnZone(SpawnAreaX, SpawnAreaX, SpawnAreaLeftY, SpawnAreaRightY);
 
-	m_fTimeTillNextSpawnDestructible = 0.5f;
-	m_fTimeTillNextSpawnEnemy = 1.f;
+	//every lane and the headless simulation play from the same scenarios
+	m_Scenarios.Build(m_Parameters);
 
-	m_SpawnZone = FSpawnZone(SpawnAreaX, SpawnAreaX, SpawnAreaLeftY, SpawnAreaRightY);
+	//the first lane is the level itself, the viewing modes and the headless simulation use its input area
+	CreateLanes();
+	m_InputProvider = m_Lanes[0].InputProvider;
 
 	//TODO DONT HARDCODE
 	m_PlayerStartPosition = FVector(100.f, 900.f, 100.f);
 	m_EndbossStartPosition = FVector(1900.f, 1000.f, 100.f);
 	//TODO
 
+	m_Simulation.Initialize(m_Parameters, m_InputProvider->GetGrid(), m_SpawnZone, FVector2D(m_PlayerStartPosition.X, m_PlayerStartPosition.Y));
+	m_Evaluator.Initialize(m_Parameters, m_InputProvider->GetGrid(), m_SpawnZone, FVector2D(m_PlayerStartPosition.X, m_PlayerStartPosition.Y));
+	m_Race.Initialize(m_Parameters);
+	m_Episodes.Initialize(m_Parameters);
+	m_HardStates.Initialize(m_Parameters);
+
+	m_fStepAccumulator = 0.f;
+	m_fSimulationSpeed = 1.f;
+	m_bUncappedSpeed = false;
+	m_dMeasuredSimSeconds = 0.0;
+	m_dMeasureStartSeconds = FPlatformTime::Seconds();
+	m_fSimSecondsPerWallSecond = 0.f;
+	if (m_Parameters->bFixedStepSimulation)
+	{
+		m_World->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &AMyGameMode::OnActorSpawned));
+	}
+
 	m_Endboss = m_World->SpawnActor<APlayerEndboss>(m_PlayerEndboss, FVector(100.f, -300.f, 100.f), FRotator(0.f, 0.f, 0.f));
 	
 	//NEATController
 	//create the population
-	m_Population = NewObject<UGeneticAlgorithm>(this);
-	m_Population->Initialize(m_Parameters->iPopulationSize, m_Parameters->iNumInputs, m_Parameters->iNumOutputs, this);
-	m_iGeneration = m_Population->GetGeneration();
-
-	//create the organisms
-	CreateOrganisms();
-
-	//get genotypes of the population
-	TArray<UGenome*> PopulationGenotypes = m_Population->GetGenotypes();
-
-	TArray<FSplitDepth> FSplitDepthTable = m_Population->GetFSplitDepthLookupTable();
+	m_Population = nullptr;
+	m_Islands = nullptr;
+	if (m_Parameters->iNumIslands > 1 && m_Parameters->bSteadyStateMode)
+	{
+		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("MyGameMode BeginPlay islands are not supported in steady state mode, using one population"));
+	}
 
-	//assign the genotypes to the organisms and then create their respective neural net from their genotype
-	for (int i = 0; i < m_NumberSpaceShips; ++i)
+	if (m_Parameters->iNumIslands > 1 && !m_Parameters->bSteadyStateMode)
 	{
-		m_SpaceShips[i]->AssignGenotype(PopulationGenotypes[i]);
-		m_SpaceShips[i]->GetGenotype()->CalculateNetDepth(FSplitDepthTable);
-		m_SpaceShips[i]->AssignNeuralNet(m_SpaceShips[i]->GetGenotype()->CreatePhenotype());
+		m_Islands = NewObject<UIslandModel>(this);
+		m_Islands->Initialize(m_Parameters->iNumIslands, m_Parameters->iPopulationSize, m_Parameters->iNumInputs, m_Parameters->iNumOutputs, this);
+		m_iGeneration = m_Islands->GetGeneration();
 	}
+	else
+	{
+		m_Population = NewObject<UGeneticAlgorithm>(this);
+		m_Population->Initialize(m_Parameters->iPopulationSize, m_Parameters->iNumInputs, m_Parameters->iNumOutputs, this);
+		m_iGeneration = m_Population->GetGeneration();
+	}
+
+	//create the organisms
+	CreateOrganisms();
 
-	m_fTimeTillNextSpawnDestructible = 0.5f;
-	m_fTimeTillNextSpawnEnemy = 1.5f;
-	m_fTimePlayed = 0.f;
 	m_iCurrentPlayerID = 0;
-	m_bGameReadyForCurrentPlayer = false;
+	m_iNextShipToPlay = 0;
 	m_bAllPlayed = false;
 	m_iGameState = -1;
 	m_iTrainingsStage = -1;
@@ -94,18 +114,59 @@ void AMyGameMode::BeginPlay()
 	m_bTraining = true;
 	m_bFirstEnemySpawned = false;
 	m_SimID = FDateTime::Now().ToString();
+	m_iEvaluations = 0;
+	m_dTrainingStartSeconds = FPlatformTime::Seconds();
+
+	if (!m_Parameters->bHeadlessTraining)
+	{
+		StartTrainingRound();
+	}
+}
+
+void AMyGameMode::CreateLanes()
+{
+	int NumLanes = FMath::Max(1, m_Parameters->iNumLanes);
+	if (NumLanes > 1 && m_Parameters->bSteadyStateMode)
+	{
+		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("MyGameMode CreateLanes steady state mode replaces genomes while others play, using one lane"));
+		NumLanes = 1;
+	}
+
+	//lanes are copies of the play area side by side along Y
+	float LaneWidth = SpawnAreaRightY - SpawnAreaLeftY + LaneGap;
+
+	for (int i = 0; i < NumLanes; ++i)
+	{
+		FSLane Lane;
+		Lane.fOffsetY = i * LaneWidth;
+		Lane.SpawnZone = FSpawnZone(SpawnAreaX, SpawnAreaX, SpawnAreaLeftY + Lane.fOffsetY, SpawnAreaRightY + Lane.fOffsetY);
+		Lane.InputProvider = NewObject<UNNInput>(this);
+		Lane.InputProvider->Initialize(this, Lane.fOffsetY);
+		m_Lanes.Add(Lane);
+	}
+}
+
+int AMyGameMode::GetLaneAt(float y)
+{
+	float LaneWidth = SpawnAreaRightY - SpawnAreaLeftY + LaneGap;
+	int Lane = FMath::FloorToInt((y - SpawnAreaLeftY + LaneGap * 0.5f) / LaneWidth);
+	return FMath::Clamp(Lane, 0, m_Lanes.Num() - 1);
 }
 
-FTransform AMyGameMode::GenerateSpawnLocation()
+FVector AMyGameMode::GetLaneStartPosition(int lane)
 {
-	//Feature: Edit in Editor, don't hardcode
-	int SpawnPoints = 10;
-	int PointNr = FMath::RandRange(1, SpawnPoints);
-	float Range = SpawnAreaRightY - SpawnAreaLeftY;
-	float PointWidth = Range / SpawnPoints;
-	float RandomYCoord = PointNr * PointWidth - PointWidth * 0.5;
+	return m_PlayerStartPosition + FVector(0.f, m_Lanes[lane].fOffsetY, 0.f);
+}
 
-	FVector Location = FVector(SpawnAreaX, RandomYCoord, WorldZLocation);
+bool AMyGameMode::IsLaneSpawning(int lane)
+{
+	//the first lane is the level as it always was, the others only run while they have a ship
+	return lane == 0 || (m_iGameState == -1 && m_Lanes[lane].iOrganismIndex >= 0);
+}
+
+FTransform AMyGameMode::GenerateSpawnLocation(const FSLane& lane, const FSSpawnEvent& event)
+{
+	FVector Location = FVector(lane.SpawnZone.m_UpX, FScenario::GetSpawnY(lane.SpawnZone, event.iSpawnPoint), WorldZLocation);
 	FRotator Rotation = FRotator(0, 0, 0);
 
 	FTransform MyTransform = FTransform(Rotation, Location);
@@ -114,9 +175,33 @@ FTransform AMyGameMode::GenerateSpawnLocation()
 
 void AMyGameMode::SpawnDestructibleOnTimer(float DeltaTime)
 {
-	m_fTimeTillNextSpawnDestructible -= DeltaTime;
+	for (int i = 0; i < m_Lanes.Num(); ++i)
+	{
+		if (IsLaneSpawning(i))
+		{
+			SpawnDestructibleInLane(i, DeltaTime);
+		}
+	}
+}
 
-	if (m_fTimeTillNextSpawnDestructible < 0.0f)
+void AMyGameMode::SpawnEnemySpaceshipOnTimer(float DeltaTime)
+{
+	for (int i = 0; i < m_Lanes.Num(); ++i)
+	{
+		if (IsLaneSpawning(i))
+		{
+			SpawnEnemySpaceshipInLane(i, DeltaTime);
+		}
+	}
+}
+
+void AMyGameMode::SpawnDestructibleInLane(int lane, float DeltaTime)
+{
+	FSLane& Lane = m_Lanes[lane];
+	const FScenario& Scenario = GetCurrentScenario();
+	Lane.ScenarioCursor.fDestructibleTime += DeltaTime;
+
+	while (const FSSpawnEvent* Event = Scenario.PopDestructible(Lane.ScenarioCursor))
 	{
 		if (m_DestructibleOne != nullptr)
 		{
@@ -125,15 +210,13 @@ void AMyGameMode::SpawnDestructibleOnTimer(float DeltaTime)
 				bool bSpawned = false;
 				while (bSpawned == false)
 				{
-					FTransform SpawnTransform = GenerateSpawnLocation();
+					FTransform SpawnTransform = GenerateSpawnLocation(Lane, *Event);
 					ADestructible* Destructible = m_World->SpawnActor<ADestructible>(m_DestructibleOne, SpawnTransform);
 
 					if (Destructible != nullptr)
 					{
-						float RandomVertSpeed = FMath::RandRange(200.0f, 500.0f);
-						Destructible->OurMovementComponent->SetVertSpeed(RandomVertSpeed);
+						Destructible->OurMovementComponent->SetVertSpeed(Event->fVertSpeed);
 
-						m_fTimeTillNextSpawnDestructible = m_Parameters->fSpawnTimeDestructible;
 						bSpawned = true;
 						++m_iNumEnemies;
 					}
@@ -143,11 +226,13 @@ void AMyGameMode::SpawnDestructibleOnTimer(float DeltaTime)
 	}
 }
 
-void AMyGameMode::SpawnEnemySpaceshipOnTimer(float DeltaTime)
+void AMyGameMode::SpawnEnemySpaceshipInLane(int lane, float DeltaTime)
 {
-	m_fTimeTillNextSpawnEnemy -= DeltaTime;
+	FSLane& Lane = m_Lanes[lane];
+	const FScenario& Scenario = GetCurrentScenario();
+	Lane.ScenarioCursor.fEnemyTime += DeltaTime;
 
-	if (m_fTimeTillNextSpawnEnemy < 0.0f)
+	while (const FSSpawnEvent* Event = Scenario.PopEnemy(Lane.ScenarioCursor))
 	{
 		if (m_EnemySpaceshipOne != nullptr)
 		{
@@ -156,24 +241,16 @@ void AMyGameMode::SpawnEnemySpaceshipOnTimer(float DeltaTime)
 				bool bSpawned = false;
 				while (bSpawned == false)
 				{
-					FTransform SpawnTransform = GenerateSpawnLocation();
+					FTransform SpawnTransform = GenerateSpawnLocation(Lane, *Event);
 					AEnemySpaceship* EnemyShip = m_World->SpawnActor<AEnemySpaceship>(m_EnemySpaceshipOne, SpawnTransform);
 
 					if (EnemyShip != nullptr)
 					{
-						float RandomVertSpeed = FMath::RandRange(100.0f, 300.0f);
-						EnemyShip->OurMovementComponent->SetVertSpeed(RandomVertSpeed);
-
-						float sign = FMath::RandRange(0.0f, 2.0f);
-						float RandomHorizSpeed = FMath::RandRange(100.0f, 300.0f);
-						if (sign < 1.0f)
-						{
-							RandomHorizSpeed *= -1.0f;
-							EnemyShip->OurMovementComponent->SetHorizSpeed(RandomHorizSpeed);
-						}
-						EnemyShip->OurMovementComponent->SetHorizSpeed(RandomHorizSpeed);
-
-						m_fTimeTillNextSpawnEnemy = m_Parameters->fSpawnTimeEnemyShip;
+						EnemyShip->OurMovementComponent->SetVertSpeed(Event->fVertSpeed);
+						EnemyShip->OurMovementComponent->SetHorizSpeed(Event->fHorizSpeed);
+						//bounce inside its own lane
+						EnemyShip->OurMovementComponent->SetSpawnZone(Lane.SpawnZone);
+
 						bSpawned = true;
 					}
 				}
@@ -184,7 +261,32 @@ void AMyGameMode::SpawnEnemySpaceshipOnTimer(float DeltaTime)
 
 void AMyGameMode::AwardFitnessToCurrentPlayer(float fitness)
 {
-	m_SpaceShips[m_iCurrentPlayerID]->AwardFitness(fitness);
+	//the first lane's ship, in the viewing modes the ship that is watched
+	m_ShipPool[0]->AwardFitness(fitness);
+}
+
+void AMyGameMode::AwardFitnessForKill(AActor* projectile, FVector location, float fitness)
+{
+	//the ship that fired gets the kill
+	ANNSpaceShip* Shooter = projectile ? Cast<ANNSpaceShip>(projectile->GetOwner()) : nullptr;
+	if (Shooter)
+	{
+		Shooter->AwardFitness(fitness);
+		return;
+	}
+
+	//any other projectile counts for the ship of the lane it happened in
+	if (m_iGameState == -1 && !m_Parameters->bHeadlessTraining)
+	{
+		int Lane = GetLaneAt(location.Y);
+		if (m_Lanes[Lane].iOrganismIndex >= 0)
+		{
+			m_ShipPool[Lane]->AwardFitness(fitness);
+		}
+		return;
+	}
+
+	AwardFitnessToCurrentPlayer(fitness);
 }
 
 void AMyGameMode::DestroyedEnemy()
@@ -194,14 +296,30 @@ void AMyGameMode::DestroyedEnemy()
 
 void AMyGameMode::CreateOrganisms()
 {
-	//spawn everything
 	m_NumberSpaceShips = m_Parameters->iPopulationSize;
+
+	//get genotypes of the population
+	TArray<UGenome*> PopulationGenotypes = m_Islands ? m_Islands->GetGenotypes() : m_Population->GetGenotypes();
+
+	TArray<FSplitDepth> FSplitDepthTable = m_Islands ? m_Islands->GetFSplitDepthLookupTable() : m_Population->GetFSplitDepthLookupTable();
+
+	//create the neural net of every genotype, they only get a ship when it is their turn
+	m_Organisms.SetNum(m_NumberSpaceShips);
+	for (int i = 0; i < m_NumberSpaceShips; ++i)
+	{
+		m_Organisms[i].Genome = PopulationGenotypes[i];
+		m_Organisms[i].Genome->CalculateNetDepth(FSplitDepthTable);
+		m_Organisms[i].Net = m_Organisms[i].Genome->CreatePhenotype();
+		m_Organisms[i].dFitness = 0.0;
+	}
+
+	//spawn one ship per lane
 	FVector SpawnLocation = FVector(2000.f, -500.f, 0.f);
 	FRotator SpawnRotation = FRotator(0.f, 0.f, 0.f);
 
-	for (int i = 0; i < m_NumberSpaceShips; ++i)
+	for (int i = 0; i < m_Lanes.Num(); ++i)
 	{
-		m_SpaceShips.Add(m_World->SpawnActor<ANNSpaceShip>(m_NNSpaceShips, SpawnLocation, SpawnRotation));
+		m_ShipPool.Add(m_World->SpawnActor<ANNSpaceShip>(m_NNSpaceShips, SpawnLocation, SpawnRotation));
 
 		//give them offsets so they dont bump into each other
 		SpawnLocation.X -= 200.f;
@@ -211,105 +329,128 @@ void AMyGameMode::CreateOrganisms()
 			SpawnLocation.Y -= 150.f;
 		}
 	}
+}
 
-	SpawnLocation.X -= 300.f;
+void AMyGameMode::BindShip(ANNSpaceShip* ship, int organismIndex)
+{
+	ship->AssignGenotype(m_Organisms[organismIndex].Genome);
+	ship->AssignNeuralNet(m_Organisms[organismIndex].Net);
+	ship->Reset();
+}
 
-	for (int i = 0; i < m_Parameters->iNumBestOrganisms; ++i)
+void AMyGameMode::StartTrainingRound()
+{
+	m_Endboss->MoveShipToStandby();
+
+	m_Race.BeginGeneration();
+
+	//every lane takes the next ship that has not played yet
+	m_iNextShipToPlay = 0;
+	for (int i = 0; i < m_Lanes.Num(); ++i)
 	{
-		m_BestSpaceShips.Add(m_World->SpawnActor<ANNSpaceShip>(m_NNSpaceShips, SpawnLocation, SpawnRotation));
+		AssignNextShip(i);
+	}
+}
 
-		SpawnLocation.X -= 200.f;
-		if (SpawnLocation.X < 500.f)
+void AMyGameMode::AssignNextShip(int lane)
+{
+	FSLane& Lane = m_Lanes[lane];
+	ANNSpaceShip* Ship = m_ShipPool[lane];
+
+	//move previous player to standby
+	Ship->MoveShipToStandby();
+
+	ResetLane(lane);
+	Lane.fTimePlayed = 0.f;
+	Lane.RaceRun.Reset();
+	Lane.iOrganismIndex = -1;
+
+	if (m_iNextShipToPlay < m_NumberSpaceShips)
+	{
+		Lane.iOrganismIndex = m_iNextShipToPlay;
+		++m_iNextShipToPlay;
+		BindShip(Ship, Lane.iOrganismIndex);
+		Ship->MoveShipToStart(GetLaneStartPosition(lane));
+
+		if (lane == 0)
 		{
-			SpawnLocation.X = 2000.f;
-			SpawnLocation.Y -= 150.f;
+			m_iCurrentPlayerID = Lane.iOrganismIndex;
 		}
 	}
-
-	SpawnLocation.X -= 300.f;
-	m_BestSpaceShip = m_World->SpawnActor<ANNSpaceShip>(m_NNSpaceShips, SpawnLocation, SpawnRotation);
 }
 
-void AMyGameMode::ResetGameForCurrentPlayer()
+void AMyGameMode::ResetLane(int lane)
 {
-	//just move all best ships back... maybe Feature: identify last ship as best or regular etc pp
-	for (ANNSpaceShip* curBestShip : m_BestSpaceShips)
+	//the next run starts the scenario from the beginning
+	m_Lanes[lane].ScenarioCursor = FSScenarioCursor();
+
+	//one lane owns the whole level
+	if (m_Lanes.Num() == 1)
 	{
-		curBestShip->MoveShipToStandby();
+		ResetGame();
+		return;
 	}
-	m_BestSpaceShip->MoveShipToStandby();
-	m_Endboss->MoveShipToStandby();
 
-	if (m_bAllPlayed)
+	for (TObjectIterator<AProjectile> ProjIter; ProjIter; ++ProjIter)
 	{
-		//move last player to standby
-		m_SpaceShips[m_iCurrentPlayerID]->MoveShipToStandby();
-		//game needs to be reset for first ship from next generation
-		m_bGameReadyForCurrentPlayer = false;
+		if (GetLaneAt(ProjIter->GetActorLocation().Y) == lane)
+		{
+			ProjIter->Destroy();
+		}
 	}
-	else if (m_iCurrentPlayerID == 0)
+
+	for (TObjectIterator<ADestructible> DestructIter; DestructIter; ++DestructIter)
 	{
-		ResetGame();
-		//move first player in position
-		m_SpaceShips[m_iCurrentPlayerID]->MoveShipToStart(m_PlayerStartPosition);
-		m_bGameReadyForCurrentPlayer = true;
+		if (GetLaneAt(DestructIter->GetActorLocation().Y) == lane)
+		{
+			DestructIter->Destroy();
+		}
 	}
-	else
+
+	for (TObjectIterator<AEnemySpaceship> EnemyIter; EnemyIter; ++EnemyIter)
 	{
-		ResetGame();
-		//move previous player to standby
-		m_SpaceShips[m_iCurrentPlayerID - 1]->MoveShipToStandby();
-		m_SpaceShips[m_iCurrentPlayerID]->MoveShipToStart(m_PlayerStartPosition);
-		m_bGameReadyForCurrentPlayer = true;
+		if (GetLaneAt(EnemyIter->GetActorLocation().Y) == lane)
+		{
+			EnemyIter->Destroy();
+		}
 	}
 }
 
 void AMyGameMode::ResetGameForBestPlayer(int shipIndex)
 {
 	ResetGame();
-	//move current player to standby
-	//just move all best ships back... maybe Feature: identify last ship as best or regular etc pp
-	for (ANNSpaceShip* curBestShip : m_BestSpaceShips)
+	//move current players to standby
+	m_Endboss->MoveShipToStandby();
+	for (ANNSpaceShip* curShip : m_ShipPool)
 	{
-		curBestShip->MoveShipToStandby();
+		curShip->MoveShipToStandby();
 	}
-	m_BestSpaceShip->MoveShipToStandby();
-	m_Endboss->MoveShipToStandby();
-	m_SpaceShips[m_iCurrentPlayerID]->MoveShipToStandby();
-	//move best ship in position
+
+	//the first ship of the pool plays the best net, the runs of the lanes start over when training resumes
+	ANNSpaceShip* Ship = m_ShipPool[0];
 	if (shipIndex == -1)
 	{
-		m_BestSpaceShip->MoveShipToStart(m_PlayerStartPosition);
+		Ship->AssignNeuralNet(m_BestNetwork);
 	}
-	else
+	else if (m_BestNetworks.IsValidIndex(shipIndex))
 	{
-		m_BestSpaceShips[shipIndex]->MoveShipToStart(m_PlayerStartPosition);
+		Ship->AssignNeuralNet(m_BestNetworks[shipIndex]);
 	}
-	m_bGameReadyForCurrentPlayer = false;
+	Ship->Reset();
+	//move best ship in position
+	Ship->MoveShipToStart(m_PlayerStartPosition);
 }
 
 int AMyGameMode::GetNumberSpecies()
 {
-	int Number = m_Population->GetNumSpecies();
+	int Number = m_Islands ? m_Islands->GetNumSpecies() : m_Population->GetNumSpecies();
 	return Number;
 }
 
 float AMyGameMode::GetCurrentPlayerYValue()
 {
-	FVector Position;
-
-	if (m_iGameState == -1)
-	{
-		Position = m_SpaceShips[m_iCurrentPlayerID]->GetActorLocation();
-	}
-	else if (m_iGameState == 0)
-	{
-		Position = m_BestSpaceShip->GetActorLocation();
-	}
-	else
-	{
-		Position = m_BestSpaceShips[m_iGameState - 1]->GetActorLocation();
-	}
+	//the first lane in training, the watched ship otherwise
+	FVector Position = m_ShipPool[0]->GetActorLocation();
 
 	return Position.Y;
 }
@@ -359,7 +500,20 @@ void AMyGameMode::Tick(float DeltaTime)
 	break;
 	}
 	}*/
-	if (m_bTraining)
+	if (m_Parameters->bFixedStepSimulation)
+	{
+		StepFixed(DeltaTime);
+	}
+	else
+	{
+		StepGame(DeltaTime);
+	}
+}
+
+void AMyGameMode::StepGame(float DeltaTime)
+{
+	//headless training leaves the level empty
+	if (m_bTraining && !m_Parameters->bHeadlessTraining)
 	{
 		SpawnDestructibleOnTimer(DeltaTime);
 		if (m_Parameters->bSimpleMode == false)
@@ -374,27 +528,169 @@ void AMyGameMode::Tick(float DeltaTime)
 	}
 }
 
-//you may ask why... because I'm still pretty bad at programming
-bool AMyGameMode::UpdateNN(run_type runType, float DeltaTime)
+void AMyGameMode::StepFixed(float DeltaTime)
 {
-	switch (m_iGameState)
+	const float TimeStep = m_Parameters->fFixedTimeStep;
+	const double FrameStart = FPlatformTime::Seconds();
+	const double Deadline = FrameStart + m_Parameters->fFixedStepFrameBudgetMs / 1000.0;
+
+	if (TimeStep <= 0.f)
 	{
-	case -1:
-		if (m_bGameReadyForCurrentPlayer)
+		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("MyGameMode StepFixed fFixedTimeStep has to be positive"));
+		return;
+	}
+
+	m_fStepAccumulator += DeltaTime * m_fSimulationSpeed;
+
+	//a due step always runs, so the game moves even if the budget is too small
+	int Steps = 0;
+	while ((m_bUncappedSpeed || m_fStepAccumulator >= TimeStep) && (Steps == 0 || FPlatformTime::Seconds() < Deadline))
+	{
+		StepGame(TimeStep);
+		TickManualActors(TimeStep);
+
+		m_fStepAccumulator -= TimeStep;
+		++Steps;
+	}
+
+	//steps that did not fit are dropped instead of piling up
+	m_fStepAccumulator = FMath::Clamp(m_fStepAccumulator, 0.f, TimeStep);
+
+	m_dMeasuredSimSeconds += Steps * TimeStep;
+	double WallSeconds = FPlatformTime::Seconds() - m_dMeasureStartSeconds;
+	if (WallSeconds >= 0.5)
+	{
+		m_fSimSecondsPerWallSecond = float(m_dMeasuredSimSeconds / WallSeconds);
+		m_dMeasuredSimSeconds = 0.0;
+		m_dMeasureStartSeconds = FPlatformTime::Seconds();
+
+		//the HUD widget is an asset, the speed is shown as a line on screen that the next measurement replaces
+		if (GEngine)
+		{
+			GEngine->AddOnScreenDebugMessage(int32(GetUniqueID()), 1.f, FColor::White, FString::Printf(TEXT("Sim seconds per wall second: %.1f"), m_fSimSecondsPerWallSecond));
+		}
+	}
+}
+
+void AMyGameMode::TickManualActors(float DeltaTime)
+{
+	//actors spawned during this step start moving in the next one, like they would with the engine ticking them
+	const int NumActors = m_ManuallyTickedActors.Num();
+	for (int i = 0; i < NumActors; ++i)
+	{
+		AActor* Actor = m_ManuallyTickedActors[i];
+		//a hit earlier in this step may have destroyed it
+		if (Actor == nullptr || Actor->IsPendingKill())
 		{
-			if (UpdateTraining(runType, DeltaTime))
+			continue;
+		}
+
+		if (Actor->PrimaryActorTick.bCanEverTick)
+		{
+			Actor->Tick(DeltaTime);
+		}
+
+		TInlineComponentArray<UActorComponent*> Components;
+		Actor->GetComponents(Components);
+		for (UActorComponent* Component : Components)
+		{
+			if (Component->PrimaryComponentTick.bCanEverTick && !Actor->IsPendingKill())
 			{
-				return true;
+				Component->TickComponent(DeltaTime, LEVELTICK_All, nullptr);
 			}
 		}
-		else
+	}
+
+	TArray<ANNSpaceShip*> PlayingShips;
+	GetPlayingShips(PlayingShips);
+	for (ANNSpaceShip* Ship : PlayingShips)
+	{
+		if (Ship->GetMovementComponent())
 		{
-			ResetGameForCurrentPlayer();
-			if (UpdateTraining(runType, DeltaTime))
+			Ship->GetMovementComponent()->TickComponent(DeltaTime, LEVELTICK_All, nullptr);
+		}
+	}
+
+	m_ManuallyTickedActors.RemoveAll([](AActor* Actor) { return Actor == nullptr || Actor->IsPendingKill(); });
+}
+
+void AMyGameMode::OnActorSpawned(AActor* actor)
+{
+	bool bGameActor = Cast<AProjectile>(actor) || Cast<ADestructible>(actor) || Cast<AEnemySpaceship>(actor);
+	bool bShip = Cast<ANNSpaceShip>(actor) != nullptr;
+	if (!bGameActor && !bShip)
+	{
+		return;
+	}
+
+	actor->SetActorTickEnabled(false);
+	TInlineComponentArray<UActorComponent*> Components;
+	actor->GetComponents(Components);
+	for (UActorComponent* Component : Components)
+	{
+		Component->SetComponentTickEnabled(false);
+	}
+
+	//ships are only moved while they play, see TickManualActors
+	if (bGameActor)
+	{
+		m_ManuallyTickedActors.Add(actor);
+	}
+}
+
+void AMyGameMode::GetPlayingShips(TArray<ANNSpaceShip*>& outShips)
+{
+	if (m_iGameState == -1)
+	{
+		for (int i = 0; i < m_Lanes.Num(); ++i)
+		{
+			if (m_Lanes[i].iOrganismIndex >= 0 && !m_Parameters->bHeadlessTraining)
 			{
-				return true;
+				outShips.Add(m_ShipPool[i]);
 			}
 		}
+	}
+	else
+	{
+		outShips.Add(m_ShipPool[0]);
+	}
+}
+
+bool AMyGameMode::IsFixedStepSimulation()
+{
+	return m_Parameters->bFixedStepSimulation;
+}
+
+void AMyGameMode::ChangeSimulationSpeed(float change)
+{
+	m_fSimulationSpeed = FMath::Max(1.f, m_fSimulationSpeed + change);
+}
+
+void AMyGameMode::SetUncappedSpeed(bool bUncapped)
+{
+	m_bUncappedSpeed = bUncapped;
+}
+
+void AMyGameMode::ResetSimulationSpeed()
+{
+	m_fSimulationSpeed = 1.f;
+	m_bUncappedSpeed = false;
+}
+
+//you may ask why... because I'm still pretty bad at programming
+bool AMyGameMode::UpdateNN(run_type runType, float DeltaTime)
+{
+	switch (m_iGameState)
+	{
+	case -1:
+		if (m_Parameters->bHeadlessTraining)
+		{
+			return UpdateHeadlessTraining();
+		}
+		if (UpdateTraining(runType, DeltaTime))
+		{
+			return true;
+		}
 		return false;
 	case 0:
 		if (UpdateTheBest(runType, DeltaTime))
@@ -442,80 +738,384 @@ bool AMyGameMode::UpdateTraining(run_type runType, float DeltaTime)
 {
 	if (m_bAllPlayed == false)
 	{
-		m_InputsForTheNN = m_InputProvider->CalculateInputsThisTick(GetCurrentPlayerYValue());
+		bool bAnyPlaying = false;
+		for (int i = 0; i < m_Lanes.Num(); ++i)
+		{
+			if (m_Lanes[i].iOrganismIndex < 0)
+			{
+				continue;
+			}
+
+			bAnyPlaying = true;
+			if (!UpdateLane(i, runType, DeltaTime))
+			{
+				return false;
+			}
+		}
+
+		//time for next generation?
+		if (!bAnyPlaying)
+		{
+			m_bAllPlayed = true;
+		}
+	}
+	else if (m_bAllPlayed == true)
+	{
+		//the next generation may take several frames
+		if (Epoch())
+		{
+			//update generation
+			m_iGeneration = m_Islands ? m_Islands->GetGeneration() : m_Population->GetGeneration();
+
+			//reset player
+			StartTrainingRound();
+			m_bAllPlayed = false;
+		}
+	}
+	else
+	{
+		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Blue, TEXT("SS2GMB Update m_bAllPlayed error"));
+		return false;
+	}
+	return true;
+}
+
+bool AMyGameMode::UpdateLane(int lane, run_type runType, float DeltaTime)
+{
+	FSLane& Lane = m_Lanes[lane];
+	ANNSpaceShip* Ship = m_ShipPool[lane];
+
+	//the level only has walls around the first lane
+	if (lane > 0)
+	{
+		FVector Location = Ship->GetActorLocation();
+		float ClampedY = FMath::Clamp(Location.Y, Lane.SpawnZone.m_LeftY + 50.f, Lane.SpawnZone.m_RightY - 50.f);
+		if (ClampedY != Location.Y)
+		{
+			Location.Y = ClampedY;
+			Ship->SetActorLocation(Location);
+		}
+	}
+
+	m_InputsForTheNN = Lane.InputProvider->CalculateInputsThisTick(Ship->GetActorLocation().Y);
+
+	if (!Ship->Update(m_InputsForTheNN, runType, DeltaTime))
+	{
+		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("SS2GMB ExecuteUpdate Error updating spaceships"));
+		return false;
+	}
+
+	Lane.fTimePlayed += DeltaTime;
+
+	Ship->AwardFitness(DeltaTime * m_Parameters->fFitnessPerSecond);
+	Ship->MovementReward();
+
+	int Health = Ship->GetCurrentHealth();
+	float Fitness = float(Ship->GetFitness());
+
+	//the HUD follows the first lane
+	if (lane == 0)
+	{
+		CurrentHealth = Health;
+		CurrentFitness = Fitness;
+	}
+
+	//a run that can't catch up anymore gets a conservative guess instead of the fitness it would have reached
+	double RaceEstimate = 0.0;
+	bool bRacedOut = m_Race.CheckRun(Lane.RaceRun, Lane.fTimePlayed, Fitness, RaceEstimate);
+
+	//this NN is done playing
+	if (bRacedOut || Lane.fTimePlayed > m_Parameters->fTimeLeftToPlay || Health < 1 || Fitness <= m_Parameters->fFitnessCutoff)
+	{
+		++m_iEvaluations;
+
+		if (Fitness > m_dBestFitness)
+		{
+			m_dBestFitness = Fitness;
+		}
+
+		//the ship is released, its genome keeps the result
+		int OrganismIndex = Lane.iOrganismIndex;
+		m_Organisms[OrganismIndex].dFitness = bRacedOut ? RaceEstimate : Ship->GetFitness();
+		if (!bRacedOut)
+		{
+			m_Race.FinishRun(Lane.RaceRun, Fitness);
+		}
+
+		if (m_Parameters->bSteadyStateMode)
+		{
+			FinishSteadyStateRun(OrganismIndex);
+			//the next ship plays in the same lane
+			m_iNextShipToPlay = (OrganismIndex + 1) % m_NumberSpaceShips;
+		}
+		AssignNextShip(lane);
+	}
+	return true;
+}
+
+bool AMyGameMode::UpdateHeadlessTraining()
+{
+	if (m_Parameters->bSteadyStateMode)
+	{
+		//one run per frame keeps the steady state bookkeeping the same as in the level
+		PlayHeadless(m_iCurrentPlayerID);
+		++m_iEvaluations;
+		FinishSteadyStateRun(m_iCurrentPlayerID);
+		m_iCurrentPlayerID = (m_iCurrentPlayerID + 1) % m_NumberSpaceShips;
+		return true;
+	}
+
+	if (m_bAllPlayed == false)
+	{
+		PlayGenerationHeadless();
+		m_iCurrentPlayerID = m_NumberSpaceShips - 1;
+		m_bAllPlayed = true;
+	}
 
-		if (!m_SpaceShips[m_iCurrentPlayerID]->Update(m_InputsForTheNN, runType, DeltaTime))
+	//the next generation may take several frames
+	if (Epoch())
+	{
+		m_iGeneration = m_Islands ? m_Islands->GetGeneration() : m_Population->GetGeneration();
+
+		m_iCurrentPlayerID = 0;
+		m_bAllPlayed = false;
+	}
+	return true;
+}
+
+void AMyGameMode::PlayHeadless(int organismIndex)
+{
+	FSOrganismRecord& Organism = m_Organisms[organismIndex];
+	const FScenario& Scenario = GetCurrentScenario();
+	int32 Seed = Scenario.GetSeed();
+	uint64 Hash = Organism.Genome->GetContentHash();
+
+	double Fitness = 0.0;
+	bool bCached = m_Parameters->bFitnessCache && m_FitnessCache.Find(Hash, Seed, m_iGeneration, Fitness);
+	if (!bCached || m_Parameters->bVerifyFitnessCache)
+	{
+		double Played = m_Simulation.Run(Organism.Net, Scenario);
+		CurrentHealth = m_Simulation.GetHealth();
+
+		if (m_Simulation.HasFailed())
+		{
+			GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("MyGameMode PlayHeadless the net couldn't play its episode"));
+		}
+		else if (bCached)
 		{
-			GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("SS2GMB ExecuteUpdate Error updating spaceships"));
-			return false;
+			CheckCachedFitness(Fitness, Played);
 		}
+		else if (m_Parameters->bFitnessCache)
+		{
+			m_FitnessCache.Add(Hash, Seed, Played, m_iGeneration);
+		}
+		Fitness = Played;
+	}
 
-		m_fTimePlayed += DeltaTime;
+	if (m_Parameters->bFitnessCache)
+	{
+		m_FitnessCache.RecordLookups(1, bCached ? 1 : 0);
+		if (m_Parameters->bAverageCachedFitness)
+		{
+			Fitness = m_FitnessCache.GetAverage(Hash);
+		}
+	}
+
+	Organism.dFitness = Fitness;
+	CurrentFitness = float(Fitness);
+	if (Fitness > m_dBestFitness)
+	{
+		m_dBestFitness = Fitness;
+	}
+}
 
-		AwardFitnessToCurrentPlayer(DeltaTime * m_Parameters->fFitnessPerSecond);
-		m_SpaceShips[m_iCurrentPlayerID]->MovementReward();
+void AMyGameMode::PlayGenerationHeadless()
+{
+	//organisms with the same content share their episodes, and only with the cache on can they be told apart
+	TArray<UNeuralNet*> UniqueNets;
+	TArray<uint64> UniqueHashes;
+	TArray<int> UniqueOfOrganism;
+	TMap<uint64, int> UniqueOfHash;
+	int NumLookups = 0;
+	int NumHits = 0;
+
+	UniqueOfOrganism.SetNum(m_NumberSpaceShips);
+	for (int i = 0; i < m_NumberSpaceShips; ++i)
+	{
+		uint64 Hash = m_Parameters->bFitnessCache ? m_Organisms[i].Genome->GetContentHash() : 0;
+		const int* SameContent = m_Parameters->bFitnessCache ? UniqueOfHash.Find(Hash) : nullptr;
+		if (SameContent)
+		{
+			UniqueOfOrganism[i] = *SameContent;
+			++NumLookups;
+			++NumHits;
+			continue;
+		}
 
-		CurrentHealth = m_SpaceShips[m_iCurrentPlayerID]->GetCurrentHealth();
-		CurrentFitness = float(m_SpaceShips[m_iCurrentPlayerID]->GetFitness());
+		UniqueOfOrganism[i] = UniqueNets.Add(m_Organisms[i].Net);
+		UniqueHashes.Add(Hash);
+		if (m_Parameters->bFitnessCache)
+		{
+			UniqueOfHash.Add(Hash, UniqueOfOrganism[i]);
+		}
+	}
 
-		//this NN is done playing
-		if (m_fTimePlayed > m_Parameters->fTimeLeftToPlay || CurrentHealth < 1 || CurrentFitness <= m_Parameters->fFitnessCutoff)
+	//episode k of every genome is played in the same scenario
+	int FirstScenario = GetCurrentScenarioIndex();
+	m_Episodes.Begin(UniqueNets.Num(), m_Scenarios.Num());
+
+	TArray<int> RoundGenomes;
+	TArray<UNeuralNet*> Nets;
+	TArray<const FScenario*> Scenarios;
+	TArray<int> GenomeOfNet;
+	//cache hits that are only replayed to verify them
+	TArray<bool> CachedNets;
+	TArray<double> CachedFitness;
+	TArray<double> NetFitness;
+	while (m_Episodes.NextRound(RoundGenomes))
+	{
+		Nets.Reset();
+		Scenarios.Reset();
+		GenomeOfNet.Reset();
+		CachedNets.Reset();
+		CachedFitness.Reset();
+		for (int curGenome : RoundGenomes)
 		{
-			//reset time played
-			m_fTimePlayed = 0;
-			//next player
-			++m_iCurrentPlayerID;
-			//need to ready game for next player
-			m_bGameReadyForCurrentPlayer = false;
+			const FScenario& Scenario = m_Scenarios.Get(FirstScenario + m_Episodes.GetStats(curGenome).iCount);
+
+			bool bCached = false;
+			double Cached = 0.0;
+			if (m_Parameters->bFitnessCache)
+			{
+				++NumLookups;
 
-			if (CurrentFitness > m_dBestFitness)
+				bCached = m_FitnessCache.Find(UniqueHashes[curGenome], Scenario.GetSeed(), m_iGeneration, Cached);
+				if (bCached)
+				{
+					++NumHits;
+					if (!m_Parameters->bVerifyFitnessCache)
+					{
+						m_Episodes.AddResult(curGenome, Cached);
+						continue;
+					}
+				}
+			}
+
+			Nets.Add(UniqueNets[curGenome]);
+			Scenarios.Add(&Scenario);
+			GenomeOfNet.Add(curGenome);
+			CachedNets.Add(bCached);
+			CachedFitness.Add(Cached);
+		}
+
+		m_Evaluator.Evaluate(Nets, Scenarios, NetFitness);
+		//only episodes that were actually played count, cache hits cost nothing
+		m_iEvaluations += Nets.Num();
+
+		for (int i = 0; i < Nets.Num(); ++i)
+		{
+			m_Episodes.AddResult(GenomeOfNet[i], NetFitness[i]);
+			//the evaluator has already reported runs that couldn't be played, they aren't cached
+			if (m_Evaluator.GetSimulation(i).HasFailed())
 			{
-				m_dBestFitness = CurrentFitness;
+				continue;
 			}
 
-			//time for next generation?
-			if (m_iCurrentPlayerID > (m_NumberSpaceShips - 1))
+			if (CachedNets[i])
 			{
-				m_bAllPlayed = true;
-				//we are still at the last ship
-				--m_iCurrentPlayerID;
+				CheckCachedFitness(CachedFitness[i], NetFitness[i]);
+			}
+			else if (m_Parameters->bFitnessCache)
+			{
+				m_FitnessCache.Add(UniqueHashes[GenomeOfNet[i]], Scenarios[i]->GetSeed(), NetFitness[i], m_iGeneration);
 			}
 		}
+
+		if (Nets.Num() > 0)
+		{
+			CurrentHealth = m_Evaluator.GetSimulation(Nets.Num() - 1).GetHealth();
+		}
 	}
-	else if (m_bAllPlayed == true)
+
+	if (m_Parameters->bFitnessCache)
 	{
-		Epoch();
+		m_FitnessCache.RecordLookups(NumLookups, NumHits);
+		//contents that died out won't come back
+		m_FitnessCache.RemoveUnused(m_iGeneration);
+	}
 
-		//update generation
-		m_iGeneration = m_Population->GetGeneration();
+	//the best net so far looks for the crowded moments, the first generation has none yet
+	TArray<double> ForkFitness;
+	if (m_Parameters->bForkedEvaluation)
+	{
+		UNeuralNet* Explorer = (m_BestNetwork && m_BestNetwork->IsUsable()) ? m_BestNetwork : m_Organisms[0].Net;
+		m_HardStates.Build(m_Simulation, Explorer, m_Scenarios, FirstScenario);
+		m_Evaluator.EvaluateForks(UniqueNets, m_HardStates.GetStates(), ForkFitness);
+	}
 
-		//reset player
-		m_iCurrentPlayerID = 0;
-		m_bAllPlayed = false;
+	//Epoch selects on the mean of the episodes
+	m_GenotypeFitness.SetNum(m_NumberSpaceShips);
+	for (int i = 0; i < m_NumberSpaceShips; ++i)
+	{
+		int Unique = UniqueOfOrganism[i];
+		double Fitness = m_Episodes.GetStats(Unique).dMean;
+		if (m_Parameters->bFitnessCache && m_Parameters->bAverageCachedFitness)
+		{
+			Fitness = m_FitnessCache.GetAverage(UniqueHashes[Unique]);
+		}
+		if (m_Parameters->bForkedEvaluation)
+		{
+			Fitness += m_Parameters->fForkFitnessWeight * ForkFitness[Unique];
+		}
+
+		m_GenotypeFitness[i] = Fitness;
+		m_Organisms[i].dFitness = Fitness;
+
+		if (Fitness > m_dBestFitness)
+		{
+			m_dBestFitness = Fitness;
+		}
 	}
-	else
+
+	CurrentFitness = float(m_GenotypeFitness[m_NumberSpaceShips - 1]);
+}
+
+void AMyGameMode::CheckCachedFitness(double cached, double played)
+{
+	if (cached != played)
 	{
-		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Blue, TEXT("SS2GMB Update m_bAllPlayed error"));
-		return false;
+		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, FString::Printf(TEXT("MyGameMode CheckCachedFitness replay gave %f, the cache %f"), played, cached));
 	}
-	return true;
+}
+
+int AMyGameMode::GetCurrentScenarioIndex()
+{
+	//every ship of a generation gets the same scenario, it changes every iGenerationsPerScenario generations
+	return m_iGeneration / FMath::Max(1, m_Parameters->iGenerationsPerScenario);
+}
+
+const FScenario& AMyGameMode::GetCurrentScenario()
+{
+	return m_Scenarios.Get(GetCurrentScenarioIndex());
 }
 
 bool AMyGameMode::UpdateTopPlayer(run_type runType, float DeltaTime, int bestPlayerIndex)
 {
 	m_InputsForTheNN = m_InputProvider->CalculateInputsThisTick(GetCurrentPlayerYValue());
 
-	if (!m_BestSpaceShips[bestPlayerIndex]->Update(m_InputsForTheNN, runType, DeltaTime))
+	//ResetGameForBestPlayer gave the first ship of the pool the net
+	ANNSpaceShip* Ship = m_ShipPool[0];
+	if (!Ship->Update(m_InputsForTheNN, runType, DeltaTime))
 	{
 		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("SS2GMB ExecuteUpdate Error updating best spaceship"));
 		return false;
 	}
 
-	CurrentHealth = m_BestSpaceShips[bestPlayerIndex]->GetCurrentHealth();
+	CurrentHealth = Ship->GetCurrentHealth();
 	//instead of letting the next ship play just continue with this guy
 	if (CurrentHealth < 1)
 	{
-		m_BestSpaceShips[bestPlayerIndex]->Reset();
+		Ship->Reset();
 	}
 	CurrentFitness = bestPlayerIndex + 1;
 
@@ -526,58 +1126,133 @@ bool AMyGameMode::UpdateTheBest(run_type runType, float DeltaTime)
 {
 	m_InputsForTheNN = m_InputProvider->CalculateInputsThisTick(GetCurrentPlayerYValue());
 
-	if (!m_BestSpaceShip->Update(m_InputsForTheNN, runType, DeltaTime))
+	ANNSpaceShip* Ship = m_ShipPool[0];
+	if (!Ship->Update(m_InputsForTheNN, runType, DeltaTime))
 	{
 		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("SS2GMB ExecuteUpdate Error updating best spaceship"));
 		return false;
 	}
 
-	CurrentHealth = m_BestSpaceShip->GetCurrentHealth();
+	CurrentHealth = Ship->GetCurrentHealth();
 	//instead of letting the next ship play just continue with this guy
 	if (CurrentHealth < 1)
 	{
-		m_BestSpaceShip->Reset();
+		Ship->Reset();
 	}
 	CurrentFitness = 9001;
 
 	return true;
 }
 
-void AMyGameMode::Epoch()
+bool AMyGameMode::Epoch()
 {
-	//get the fitness of all ships
-	for (ANNSpaceShip* curSpaceShip : m_SpaceShips)
+	bool bRunning = m_Islands ? m_Islands->IsEpochRunning() : m_Population->IsEpochRunning();
+	if (!bRunning)
+	{
+		//get the fitness of all organisms, the headless evaluation has already filled it in
+		if (m_GenotypeFitness.Num() != m_NumberSpaceShips)
+		{
+			m_GenotypeFitness.Reset();
+			for (const FSOrganismRecord& Organism : m_Organisms)
+			{
+				m_GenotypeFitness.Add(Organism.dFitness);
+			}
+		}
+
+		if (m_Islands)
+		{
+			m_Islands->BeginEpoch(m_GenotypeFitness);
+		}
+		else
+		{
+			m_Population->BeginEpoch(m_GenotypeFitness);
+		}
+	}
+
+	double Budget = m_Parameters->fEpochFrameBudgetMs / 1000.0;
+	bool bDone = m_Islands ? m_Islands->StepEpoch(Budget) : m_Population->StepEpoch(Budget);
+	if (!bDone)
 	{
-		m_GenotypeFitness.Add(curSpaceShip->GetFitness());
+		return false;
 	}
 
-	TArray<UNeuralNet*> NewNetworks = m_Population->Epoch(m_GenotypeFitness);
+	TArray<UNeuralNet*> NewNetworks = m_Islands ? m_Islands->FinishEpoch() : m_Population->FinishEpoch();
 
 	//log experiment data to file; uses m_GenotypeFitness so called here before values are reset
 	LogDataToFile(m_GenotypeFitness);
 
 	m_GenotypeFitness.Empty();
 
-	//assign the new networks to the spaceships and reset
+	//assign the new genotypes and networks to the organisms and reset
+	TArray<UGenome*> PopulationGenotypes = m_Islands ? m_Islands->GetGenotypes() : m_Population->GetGenotypes();
 	for (int i = 0; i < m_NumberSpaceShips; ++i)
 	{
-		m_SpaceShips[i]->AssignNeuralNet(NewNetworks[i]);
-		m_SpaceShips[i]->Reset();
+		m_Organisms[i].Genome = PopulationGenotypes[i];
+		m_Organisms[i].Net = NewNetworks[i];
+		m_Organisms[i].dFitness = 0.0;
 	}
 
-	//get the NN of the best performer form last generation
-	TArray<UNeuralNet*> BestNetworks = m_Population->GetLastGenerationsBestPhenotypes();
+	AssignBestNetworks();
+
+	return true;
+}
+
+void AMyGameMode::FinishSteadyStateRun(int organismIndex)
+{
+	UNeuralNet* NewNetwork = nullptr;
+	int ReplacedSlot = m_Population->ReportEvaluation(organismIndex, m_Organisms[organismIndex].dFitness, NewNetwork);
 
-	//record them and reset
-	for (int i = 0; i < m_BestSpaceShips.Num(); ++i)
+	//the organism plays again in the next round, either with its old genome or with the one that replaced it
+	if (ReplacedSlot >= 0)
 	{
-		m_BestSpaceShips[i]->AssignNeuralNet(BestNetworks[i]);
-		m_BestSpaceShips[i]->Reset();
+		m_Organisms[ReplacedSlot].Genome = m_Population->GetGenome(ReplacedSlot);
+		m_Organisms[ReplacedSlot].Net = NewNetwork;
+		m_Organisms[ReplacedSlot].dFitness = 0.0;
 	}
 
+	//a population worth of runs counts as a generation for the log and the best ships
+	if (m_iEvaluations % m_NumberSpaceShips == 0)
+	{
+		m_Population->EndSteadyStateRound();
+		m_Race.BeginGeneration();
+		if (m_Parameters->bFitnessCache)
+		{
+			m_FitnessCache.RemoveUnused(m_iGeneration);
+		}
+
+		for (int i = 0; i < m_NumberSpaceShips; ++i)
+		{
+			m_GenotypeFitness.Add(m_Population->GetGenome(i)->GetFitness());
+		}
+		LogDataToFile(m_GenotypeFitness);
+		m_GenotypeFitness.Empty();
+
+		AssignBestNetworks();
+
+		m_iGeneration = m_Population->GetGeneration();
+	}
+}
+
+void AMyGameMode::AssignBestNetworks()
+{
+	//get the NN of the best performer form last generation
+	TArray<UNeuralNet*> BestNetworks = m_Islands ? m_Islands->GetLastGenerationsBestPhenotypes() : m_Population->GetLastGenerationsBestPhenotypes();
+
+	//record them, a ship gets them when the user wants to watch one
+	m_BestNetworks = BestNetworks;
+
 	//do the same for the best ship
-	m_BestSpaceShip->AssignNeuralNet(m_Population->GetBestPhenotype());
-	m_BestSpaceShip->Reset();
+	m_BestNetwork = m_Islands ? m_Islands->GetBestPhenotype() : m_Population->GetBestPhenotype();
+}
+
+float AMyGameMode::GetEvaluationsPerHour()
+{
+	double Hours = (FPlatformTime::Seconds() - m_dTrainingStartSeconds) / 3600.0;
+	if (Hours <= 0.0)
+	{
+		return 0.f;
+	}
+	return float(m_iEvaluations / Hours);
 }
 
 void AMyGameMode::PlayVsBestShipNr(int shipNumber)
@@ -603,10 +1278,31 @@ void AMyGameMode::ReturnToTraining()
 {
 	m_iGameState = -1;
 	m_bTraining = true;
-	ResetGameForCurrentPlayer();
-	//need to reset the current player completely, he starts new
-	m_fTimePlayed = 0.f;
-	m_SpaceShips[m_iCurrentPlayerID]->Reset();
+
+	m_Endboss->MoveShipToStandby();
+	for (ANNSpaceShip* curShip : m_ShipPool)
+	{
+		curShip->MoveShipToStandby();
+	}
+
+	if (m_Parameters->bHeadlessTraining)
+	{
+		return;
+	}
+
+	//need to reset the current players completely, they start new. The first ship was lent to the viewing mode
+	ResetGame();
+	for (int i = 0; i < m_Lanes.Num(); ++i)
+	{
+		FSLane& Lane = m_Lanes[i];
+		if (Lane.iOrganismIndex >= 0)
+		{
+			Lane.fTimePlayed = 0.f;
+			Lane.RaceRun.Reset();
+			BindShip(m_ShipPool[i], Lane.iOrganismIndex);
+			m_ShipPool[i]->MoveShipToStart(GetLaneStartPosition(i));
+		}
+	}
 }
 
 void AMyGameMode::ResetGame()
@@ -628,6 +1324,11 @@ void AMyGameMode::ResetGame()
 
 	m_iNumEnemies = 0;
 	m_bFirstEnemySpawned = false;
+
+	for (FSLane& curLane : m_Lanes)
+	{
+		curLane.ScenarioCursor = FSScenarioCursor();
+	}
 }
 
 void AMyGameMode::LogDataToFile(const TArray<double> &genotypeFitness)
@@ -673,7 +1374,17 @@ void AMyGameMode::LogDataToFile(const TArray<double> &genotypeFitness)
 		log.Append("bestFitness;");
 		log.Append("numSpecies;");
 		log.Append("avgLinks;");
-		log.Append("avgNeurons");
+		log.Append("avgNeurons;");
+		log.Append("arenaPeakKB;");
+		log.Append("geneAllocs;");
+		log.Append("crossoversPerMs;");
+		log.Append("distCacheHitRate;");
+		log.Append("leaderRuledOutRate;");
+		log.Append("evalsPerHour;");
+		log.Append("racedOutRuns;");
+		log.Append("raceSecondsSaved;");
+		log.Append("fitnessCacheHitRate;");
+		log.Append("episodesPerGenome");
 		log += LINE_TERMINATOR;
 		FFileHelper::SaveStringToFile(log, *expName);
 		log = "";
@@ -681,8 +1392,19 @@ void AMyGameMode::LogDataToFile(const TArray<double> &genotypeFitness)
 		FFileHelper::SaveStringToFile(config, *confName);
 	}
 
-	log += FString::FromInt(m_iGeneration) + ";" + FString::FromInt(int(avgFitness)) + ";" + FString::FromInt(int(bestFitness)) + ";" + FString::FromInt(m_Population->GetNumSpecies()) +
-		";" + m_Population->GetGenomeStats() + LINE_TERMINATOR;
+	//only the headless generations play several episodes
+	bool bMultiEpisode = m_Parameters->bHeadlessTraining && !m_Parameters->bSteadyStateMode;
+	float EpisodesPerGenome = bMultiEpisode ? float(m_Episodes.GetEpisodesPlayed()) / m_NumberSpaceShips : 1.f;
+
+	int NumRacedOut = 0;
+	float RaceSecondsSaved = 0.f;
+	m_Race.ConsumeStats(NumRacedOut, RaceSecondsSaved);
+
+	log += FString::FromInt(m_iGeneration) + ";" + FString::FromInt(int(avgFitness)) + ";" + FString::FromInt(int(bestFitness)) + ";" + FString::FromInt(GetNumberSpecies()) +
+		";" + (m_Islands ? m_Islands->GetGenomeStats() : m_Population->GetGenomeStats()) + ";" + FString::SanitizeFloat(GetEvaluationsPerHour()) +
+		";" + FString::FromInt(NumRacedOut) + ";" + FString::SanitizeFloat(RaceSecondsSaved) +
+		";" + FString::SanitizeFloat(m_FitnessCache.ConsumeHitRate()) +
+		";" + FString::SanitizeFloat(EpisodesPerGenome) + LINE_TERMINATOR;
 
 	FFileHelper::SaveStringToFile(log, *expName, FFileHelper::EEncodingOptions::AutoDetect, &IFileManager::Get(), 0x08);
 }
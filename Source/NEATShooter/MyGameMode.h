@@ -16,6 +16,13 @@
 
 
 #include "Globals.h"
+#include "EpisodeScheduler.h"
+#include "FitnessCache.h"
+#include "FitnessRace.h"
+#include "HardStateLibrary.h"
+#include "HeadlessSimulation.h"
+#include "PopulationEvaluator.h"
+#include "Scenario.h"
 
 #include "CoreMinimal.h"
 #include "GameFramework/GameModeBase.h"
@@ -23,12 +30,62 @@
 
 
 class UGeneticAlgorithm;
+class UIslandModel;
 class UNNInput;
+class UGenome;
+class UNeuralNet;
 class ANNSpaceShip;
 class APlayerEndboss;
 class UParameters;
 
 
+//Everything that belongs to one genome of the population. A ship actor is only bound to it while it plays
+USTRUCT()
+struct FSOrganismRecord
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+		UGenome* Genome;
+	UPROPERTY()
+		//phenotype of the genome
+		UNeuralNet* Net;
+
+	//fitness of the last run
+	double dFitness;
+
+	FSOrganismRecord() : Genome(nullptr), Net(nullptr), dFitness(0.0) {}
+};
+
+//One of the iNumLanes copies of the play area side by side. Every lane replays the scenario with its own enemies and its own ship playing
+USTRUCT()
+struct FSLane
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+		//input area of this lane
+		UNNInput* InputProvider;
+	UPROPERTY()
+		FSpawnZone SpawnZone;
+
+	//distance to the first lane along Y
+	float fOffsetY;
+
+	//organism playing in this lane, -1 if it has nobody left to play
+	int iOrganismIndex;
+	//time the ship has played
+	float fTimePlayed;
+
+	//how far the lane has played the scenario
+	FSScenarioCursor ScenarioCursor;
+
+	//checkpoints the current run passed
+	FSRaceRun RaceRun;
+
+	FSLane() : InputProvider(nullptr), fOffsetY(0.f), iOrganismIndex(-1), fTimePlayed(0.f) {}
+};
+
 //Central controller of this project. Handels the rules for the game and manages the training of the neural nets. Runs the genetic algorithm afterwards and keeps track of everything
 UCLASS()
 class NEATSHOOTER_API AMyGameMode : public AGameModeBase
@@ -43,18 +100,21 @@ private:
 		//this object holds all simulation parameters
 		UParameters* m_Parameters;
 
-	//keep track of spawn times
-	float m_fTimeTillNextSpawnDestructible;
-	float m_fTimeTillNextSpawnEnemy;
-
 	UPROPERTY()
-		//contains the dimensions of the spawn zone
+		//contains the dimensions of the spawn zone of the first lane
 		FSpawnZone m_SpawnZone;
 
 	UPROPERTY()
-		//handles the calculation of the play-area input
+		//handles the calculation of the play-area input of the first lane
 		UNNInput* m_InputProvider;
 
+	UPROPERTY()
+		//the lanes the population plays in, at least one
+		TArray<FSLane> m_Lanes;
+
+	//next ship that gets a lane this generation
+	int m_iNextShipToPlay;
+
 	UPROPERTY()
 		//updated every tick then given to the current playing NN for its calculations
 		TArray<double> m_InputsForTheNN;
@@ -86,13 +146,10 @@ private:
 	//first enemy every level spawned?
 	bool m_bFirstEnemySpawned;//TODO
 
-	//index to our currently playing spaceship
+	//index to our currently playing spaceship in the first lane
 	int m_iCurrentPlayerID;
-	//time current player has played
-	float m_fTimePlayed;
 	//true if all organisms of the current generation have played
 	bool m_bAllPlayed;
-	bool m_bGameReadyForCurrentPlayer;
 
 	UPROPERTY()
 		//where the actors spawn to play the game
@@ -103,16 +160,65 @@ private:
 	//unique ID everytime simulation is started to log experiment data
 	FString m_SimID;
 
+	//finished training runs and when training started, for the throughput
+	int m_iEvaluations;
+	double m_dTrainingStartSeconds;
+
+	//fixed step mode: frame time not simulated yet, how many sim-seconds per wall-second are asked for and
+	//true if as many steps as the frame budget allows are run
+	float m_fStepAccumulator;
+	float m_fSimulationSpeed;
+	bool m_bUncappedSpeed;
+	//sim-seconds and wall time since the last measurement
+	double m_dMeasuredSimSeconds;
+	double m_dMeasureStartSeconds;
+	float m_fSimSecondsPerWallSecond;
+
+	UPROPERTY()
+		//enemies, destructibles and projectiles the fixed steps tick instead of the engine
+		TArray<AActor*> m_ManuallyTickedActors;
+
+	//plays the game without the engine for bHeadlessTraining, a single run or a whole generation at once
+	FHeadlessSimulation m_Simulation;
+	FPopulationEvaluator m_Evaluator;
+	//headless results of the genome contents that are still in the population
+	FFitnessCache m_FitnessCache;
+	//spreads the headless episodes of a generation over the genomes
+	FEpisodeScheduler m_Episodes;
+	//crowded moments of this generation the genomes are forked from
+	FHardStateLibrary m_HardStates;
+
+	//stops runs in the level that fell too far behind the generation to survive selection
+	FFitnessRace m_Race;
+
+	//the enemy spawns the generations play, in the level and headless
+	FScenarioLibrary m_Scenarios;
+
+
+
+	//Returns the location of the event's spawn point in the lane
+	FTransform GenerateSpawnLocation(const FSLane& lane, const FSSpawnEvent& event);
 
+	void SpawnDestructibleInLane(int lane, float DeltaTime);
+	void SpawnEnemySpaceshipInLane(int lane, float DeltaTime);
 
-	//Returns a valid random spawn location for an enemy. Currently has 10 "spawn points" 
-	FTransform GenerateSpawnLocation();
+	//Lays out iNumLanes lanes next to the play area of the level
+	void CreateLanes();
+	//Lane the Y coordinate lies in, the gaps belong to the nearest lane
+	int GetLaneAt(float y);
+	FVector GetLaneStartPosition(int lane);
+	//True if enemies are spawned in the lane right now
+	bool IsLaneSpawning(int lane);
 
 	//Deletes all enemy objects and resets some values
 	void ResetGame();
 
-	//After prev. organism is done playing ready playing field for next
-	void ResetGameForCurrentPlayer();
+	//Gives every lane the first ships of the generation
+	void StartTrainingRound();
+	//After prev. organism is done playing ready the lane for the next one, if there is one left
+	void AssignNextShip(int lane);
+	//Deletes all enemy objects in the lane
+	void ResetLane(int lane);
 	void ResetGameForBestPlayer(int shipIndex);
 
 	//Used to calculate the position input from the organism
@@ -121,10 +227,35 @@ private:
 	//Log Data and calc stats
 	void LogDataToFile(const TArray<double> &genotypeFitness);
 
+	//One update of spawns and nets, the engine moves everything afterwards
+	void StepGame(float DeltaTime);
+	//Fixed step mode: runs the steps that are due this frame within the frame budget
+	void StepFixed(float DeltaTime);
+	//Moves everything the engine would otherwise tick by one fixed step
+	void TickManualActors(float DeltaTime);
+	//Fixed step mode: stops the engine from ticking actors the fixed steps tick
+	void OnActorSpawned(AActor* actor);
+	//The ships the nets are updated for in the current game state
+	void GetPlayingShips(TArray<ANNSpaceShip*>& outShips);
+
 	//Selects the right Update-function depending on the current simulation mode
 	bool UpdateNN(run_type runType, float DeltaTime);
 	//Called in UpdateNEAT to update the NN for the currently training organism, returns false if there was an error
 	bool UpdateTraining(run_type runType, float DeltaTime);
+	//Updates the NN playing in the lane, returns false if there was an error
+	bool UpdateLane(int lane, run_type runType, float DeltaTime);
+	//Used instead of UpdateTraining if bHeadlessTraining is set. Plays a whole generation (or one run in steady state mode) in the
+	//headless simulation, the level is not touched
+	bool UpdateHeadlessTraining();
+	//Plays the organism's net in the headless simulation and records its fitness
+	void PlayHeadless(int organismIndex);
+	//Plays the episodes of all ships, several at once, and fills m_GenotypeFitness with their means for the next Epoch
+	void PlayGenerationHeadless();
+	//bVerifyFitnessCache: reports a replay of a cache hit that didn't reach the cached fitness
+	void CheckCachedFitness(double cached, double played);
+	//The scenario all ships of the current generation play, the first one if they play several
+	int GetCurrentScenarioIndex();
+	const FScenario& GetCurrentScenario();
 	//Called in UpdateNEAT to update the NN for the currently playing top 5 organism, returns false if there was an error
 	bool UpdateTopPlayer(run_type runType, float DeltaTime, int bestPlayerIndex);
 	//Called in UpdateNEAT to update the NN for the currently playing all time best organism, returns false if there was an error
@@ -135,19 +266,25 @@ private:
 	UPROPERTY()
 		//storage for the entire population of genotypes (chromosomes)
 		UGeneticAlgorithm* m_Population;
+	UPROPERTY()
+		//used instead of m_Population if the population is split into islands
+		UIslandModel* m_Islands;
 
 	UPROPERTY()
 		//storage for all organisms (player)
-		TArray<ANNSpaceShip*> m_SpaceShips;
+		TArray<FSOrganismRecord> m_Organisms;
+	UPROPERTY()
+		//one ship per lane, bound to the organism currently playing there
+		TArray<ANNSpaceShip*> m_ShipPool;
 
+	//number of organisms
 	int m_NumberSpaceShips;
 
-	//was stupid to not include them as the last ships in the general population above. Feature
 	UPROPERTY()
-		//copies of the best performing organisms
-		TArray<ANNSpaceShip*> m_BestSpaceShips;
+		//nets of the best performing organisms, the first ship of the pool plays them when watched
+		TArray<UNeuralNet*> m_BestNetworks;
 	UPROPERTY()
-		ANNSpaceShip* m_BestSpaceShip;
+		UNeuralNet* m_BestNetwork;
 
 	//all time best fitness
 	double m_dBestFitness;
@@ -160,11 +297,20 @@ private:
 		TArray<double> m_GenotypeFitness;
 
 
-	//Spawns all the required actors for the organisms in the world
+	//Creates the records of all organisms and spawns the ship pool
 	void CreateOrganisms();
+	//Gives the ship the genome and net of the organism and resets it
+	void BindShip(ANNSpaceShip* ship, int organismIndex);
+
+	//Works on the next generation of networks within the frame budget. Once it is done updates the organisms
+	//with them and returns true
+	bool Epoch();
+
+	//Steady state mode: hands the finished run to the GA and swaps in the offspring that replaced a genome
+	void FinishSteadyStateRun(int organismIndex);
 
-	//Creates the next generation of networks, updates the spaceships with them and resets the ships
-	void Epoch();
+	//Records the nets of the best genomes
+	void AssignBestNetworks();
 
 
 	virtual void Tick(float DeltaTime) override;
@@ -194,6 +340,9 @@ public:
 		float SpawnAreaX = 2100.0f;
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Spawn")
 		float WorldZLocation = 0.0f;
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Spawn")
+		//free space between two lanes
+		float LaneGap = 500.0f;
 
 	//Spawn functions for enemies
 	UFUNCTION(BlueprintCallable, Category = "GamePlay")
@@ -205,10 +354,19 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "GamePlay")
 		void AwardFitnessToCurrentPlayer(float fitness);
 
+	//Gives the fitness for a kill to the ship that fired the projectile, other projectiles count for the ship of the lane
+	void AwardFitnessForKill(AActor* projectile, FVector location, float fitness);
+
 	//Called if enemy is destroyed
 	UFUNCTION(BlueprintCallable, Category = "GamePlay")
 		void DestroyedEnemy();
 
+	//speed keys in fixed step mode, they replace the time dilation
+	bool IsFixedStepSimulation();
+	void ChangeSimulationSpeed(float change);
+	void SetUncappedSpeed(bool bUncapped);
+	void ResetSimulationSpeed();
+
 	//functions for the GameInputHandler to call
 	void PlayVsBestShipNr(int shipNumber);
 	void LetBestShipNrPlay(int shipNumber);
@@ -235,6 +393,12 @@ public:
 		int GetCurrentGeneration() { return m_iGeneration; }
 	UFUNCTION(BlueprintCallable, Category = "NEAT")
 		float GetBestFitness() { return m_dBestFitness; }
+	//fixed step mode: simulated seconds per wall-clock second, measured twice a second
+	UFUNCTION(BlueprintCallable, Category = "NEAT")
+		float GetSimSecondsPerWallSecond() { return m_fSimSecondsPerWallSecond; }
+	//finished training runs per hour since training started, comparable between generational and steady state mode
+	UFUNCTION(BlueprintCallable, Category = "NEAT")
+		float GetEvaluationsPerHour();
 
 	UParameters* const GetParameters() { return m_Parameters; }
 	FSpawnZone const GetSpawnZone() { return m_SpawnZone; }
@@ -22,30 +22,93 @@
 #include "Parameters.h"
 
 
-UNNInput::UNNInput()
+FNNInputGrid::FNNInputGrid()
 {
+	m_iNumberOfRows = 0;
+	m_iNumberOfLines = 0;
+	m_fLeftY = 0.f;
+	m_fRightY = 0.f;
+	m_fTopX = 0.f;
+	m_fBottomX = 0.f;
+	m_dCellWidth = 1.0;
+	m_dCellHeight = 1.0;
 }
 
-void UNNInput::Initialize(AMyGameMode* gameMode)
+void FNNInputGrid::Initialize(int numRows, int numLines, float leftY, float rightY, float topX, float bottomX)
 {
-	m_iNumberOfRows = gameMode->GetParameters()->iNumInputRows;
-	m_iNumberOfLines = gameMode->GetParameters()->iNumInputLines;
+	m_iNumberOfRows = numRows;
+	m_iNumberOfLines = numLines;
+	m_fLeftY = leftY;
+	m_fRightY = rightY;
+	m_fTopX = topX;
+	m_fBottomX = bottomX;
 
 	//calculate cell dimensions
-	m_iNumberOfInputs = m_iNumberOfRows * m_iNumberOfLines;
-	m_dInputCellHeight = (m_InputAreaTopX - m_InputAreaBottomX) / m_iNumberOfLines;
-	m_dInputCellWidth = (m_InputAreaRightY - m_InputAreaLeftY) / m_iNumberOfRows;
+	m_dCellHeight = (m_fTopX - m_fBottomX) / m_iNumberOfLines;
+	m_dCellWidth = (m_fRightY - m_fLeftY) / m_iNumberOfRows;
+
+	m_Cells.Init(0.0, m_iNumberOfLines * m_iNumberOfRows);
+}
 
-	//create the 2D array
-	for (int i = 0; i < m_iNumberOfLines; ++i)
+void FNNInputGrid::Reset()
+{
+	for (double& Cell : m_Cells)
 	{
-		TArray<double> Lines;
-		for (int j = 0; j < m_iNumberOfRows; j++)
-		{
-			Lines.Add(0.0);
-		}
-		m_InputsForTheNN.Add(Lines);
+		Cell = 0.0;
+	}
+}
+
+void FNNInputGrid::Mark(float x, float y, double value)
+{
+	if (!Contains(x, y))
+	{
+		return;
+	}
+
+	int X = FMath::TruncToInt((x - m_fBottomX) / m_dCellHeight);
+	int Y = FMath::TruncToInt((y - m_fLeftY) / m_dCellWidth);
+
+	//the far borders are inside the area but would be the first cell past the grid
+	X = FMath::Min(X, m_iNumberOfLines - 1);
+	Y = FMath::Min(Y, m_iNumberOfRows - 1);
+
+	m_Cells[X * m_iNumberOfRows + Y] = value;
+}
+
+bool FNNInputGrid::Contains(float x, float y) const
+{
+	if (x < m_fBottomX || x > m_fTopX)
+	{
+		return false;
 	}
+	if (y < m_fLeftY || y > m_fRightY)
+	{
+		return false;
+	}
+	return true;
+}
+
+void FNNInputGrid::AppendInputs(TArray<double> &inputs, float playerY) const
+{
+	inputs.Append(m_Cells);
+
+	//where the ship is positioned on the input area in [0;1]
+	double InputAreaSpan = FMath::Abs(m_fLeftY - m_fRightY);
+	double RelativePlayerLocation = FMath::Abs(m_fLeftY - playerY);
+	double LocationInput = RelativePlayerLocation / InputAreaSpan;
+	inputs.Add(LocationInput);
+}
+
+
+
+UNNInput::UNNInput()
+{
+}
+
+void UNNInput::Initialize(AMyGameMode* gameMode, float offsetY)
+{
+	m_Grid.Initialize(gameMode->GetParameters()->iNumInputRows, gameMode->GetParameters()->iNumInputLines,
+		m_InputAreaLeftY + offsetY, m_InputAreaRightY + offsetY, m_InputAreaTopX, m_InputAreaBottomX);
 
 	m_fDestValue = gameMode->GetParameters()->fDestValue;
 	m_fEnemyValue = gameMode->GetParameters()->fEnemyValue;
@@ -54,20 +117,14 @@ void UNNInput::Initialize(AMyGameMode* gameMode)
 
 TArray<double> UNNInput::CalculateInputsThisTick(float currentPlayerYValue)
 {
-	ResetInputs();
+	m_Grid.Reset();
 
 	for (TObjectIterator<ADestructible> DestructIter; DestructIter; ++DestructIter)
 	{
 		if (DestructIter->ActorHasTag("Destructible"))
 		{
 			FVector CurrentLocation = DestructIter->GetActorLocation();
-			if (LocationInInputArea(CurrentLocation))
-			{
-				int X = FMath::TruncToInt(CurrentLocation.X / m_dInputCellHeight);
-				int Y = FMath::TruncToInt(CurrentLocation.Y / m_dInputCellWidth);
-
-				m_InputsForTheNN[X][Y] = m_fDestValue;
-			}
+			m_Grid.Mark(CurrentLocation.X, CurrentLocation.Y, m_fDestValue);
 		}
 	}
 
@@ -76,13 +133,7 @@ TArray<double> UNNInput::CalculateInputsThisTick(float currentPlayerYValue)
 		if (EnemyIter->ActorHasTag("EnemySpaceship"))
 		{
 			FVector CurrentLocation = EnemyIter->GetActorLocation();
-			if (LocationInInputArea(CurrentLocation))
-			{
-				int X = FMath::TruncToInt(CurrentLocation.X / m_dInputCellHeight);
-				int Y = FMath::TruncToInt(CurrentLocation.Y / m_dInputCellWidth);
-
-				m_InputsForTheNN[X][Y] = m_fEnemyValue;
-			}
+			m_Grid.Mark(CurrentLocation.X, CurrentLocation.Y, m_fEnemyValue);
 		}
 	}
 
@@ -91,57 +142,18 @@ TArray<double> UNNInput::CalculateInputsThisTick(float currentPlayerYValue)
 		if (ProjIter->ActorHasTag("EnemyProjectile"))
 		{
 			FVector CurrentLocation = ProjIter->GetActorLocation();
-			if (LocationInInputArea(CurrentLocation))
-			{
-				int X = FMath::TruncToInt(CurrentLocation.X / m_dInputCellHeight);
-				int Y = FMath::TruncToInt(CurrentLocation.Y / m_dInputCellWidth);
-
-				m_InputsForTheNN[X][Y] = m_fProjValue;
-			}
+			m_Grid.Mark(CurrentLocation.X, CurrentLocation.Y, m_fProjValue);
 		}
 	}
 
-	//convert the vector representing cells into a one dimensional so the NN can use it
+	//the cells line by line so the NN can use them, followed by the ship position
 	TArray<double> InputsIn1D;
-	for (int i = 0; i < m_iNumberOfLines; ++i)
-	{
-		for (int j = 0; j < m_iNumberOfRows; j++)
-		{
-			InputsIn1D.Add(m_InputsForTheNN[i][j]);
-		}
-	}
-
-	//where the ship is positioned on the input area in [0;1]
-	double InputAreaSpan = FMath::Abs(m_InputAreaLeftY - m_InputAreaRightY);
-	double RelativePlayerLocation = FMath::Abs(m_InputAreaLeftY - currentPlayerYValue);
-	double LocationInput = RelativePlayerLocation / InputAreaSpan;
-	InputsIn1D.Add(LocationInput);
+	m_Grid.AppendInputs(InputsIn1D, currentPlayerYValue);
 
 	return InputsIn1D;
 }
 
 bool UNNInput::LocationInInputArea(FVector location)
 {
-	float X = location.X;
-	float Y = location.Y;
-	if (X < m_InputAreaBottomX || X > m_InputAreaTopX)
-	{
-		return false;
-	}
-	if (Y < m_InputAreaLeftY || Y > m_InputAreaRightY)
-	{
-		return false;
-	}
-	return true;
-}
-
-void UNNInput::ResetInputs()
-{
-	for (int i = 0; i < m_iNumberOfLines; ++i)
-	{
-		for (int j = 0; j < m_iNumberOfRows; j++)
-		{
-			m_InputsForTheNN[i][j] = 0.0;
-		}
-	}
+	return m_Grid.Contains(location.X, location.Y);
 }
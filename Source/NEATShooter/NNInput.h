@@ -22,6 +22,48 @@
 class AMyGameMode;
 
 
+//The play area input as iNumInputLines * iNumInputRows cells, stored line after line. UNNInput fills it from the actors in the level,
+//the headless simulation from its own bodies, so both hand the nets the same encoding
+class NEATSHOOTER_API FNNInputGrid
+{
+private:
+	TArray<double> m_Cells;
+
+	int m_iNumberOfRows;
+	int m_iNumberOfLines;
+
+	//dimensions of the covered area
+	float m_fLeftY;
+	float m_fRightY;
+	float m_fTopX;
+	float m_fBottomX;
+
+	//calculated from the Nr of rows and lines
+	double m_dCellWidth;
+	double m_dCellHeight;
+
+public:
+	FNNInputGrid();
+	void Initialize(int numRows, int numLines, float leftY, float rightY, float topX, float bottomX);
+
+	//Sets all cells to 0.0
+	void Reset();
+
+	//Writes value into the cell containing location, later marks overwrite earlier ones. Locations outside the area are ignored
+	void Mark(float x, float y, double value);
+
+	//Returns true if the location is inside the area, the border counts as inside
+	bool Contains(float x, float y) const;
+
+	//Appends the cells and where the player is positioned on the area in [0;1]
+	void AppendInputs(TArray<double> &inputs, float playerY) const;
+
+	float GetLeftY() const { return m_fLeftY; }
+	float GetRightY() const { return m_fRightY; }
+	float GetTopX() const { return m_fTopX; }
+	float GetBottomX() const { return m_fBottomX; }
+};
+
 //Provides the input for the play area and the positional input of the currently playing organism
 UCLASS()
 class NEATSHOOTER_API UNNInput : public UObject
@@ -30,26 +72,16 @@ class NEATSHOOTER_API UNNInput : public UObject
 
 private:
 	//2D map coordinate representation
-	TArray<TArray<double>> m_InputsForTheNN;
-
-	int m_iNumberOfRows;
-	int m_iNumberOfLines;
-	int m_iNumberOfInputs;
+	FNNInputGrid m_Grid;
 
 	float m_fDestValue;
 	float m_fEnemyValue;
 	float m_fProjValue;
 
-	//calculated from the Nr of rows and lines
-	double m_dInputCellWidth;
-	double m_dInputCellHeight;
-
-	//Reset the input array to 0.0
-	void ResetInputs();
-
 public:	
 	UNNInput();
-	void Initialize(AMyGameMode* gameMode);
+	//The input area is moved by offsetY along Y, used for the lanes next to the level
+	void Initialize(AMyGameMode* gameMode, float offsetY = 0.f);
 
 	//dimensions of the play area. Feature: Don't hardcode, set values with object from editor
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = PlayArea)
@@ -66,4 +98,6 @@ public:
 
 	//Returns true if given location is inside the play area
 	bool LocationInInputArea(FVector location);
+
+	const FNNInputGrid& GetGrid() const { return m_Grid; }
 };
@@ -231,6 +231,8 @@ void ANNSpaceShip::OnFire()
 						//find launch direction
 						FVector LaunchDir = ShipRotation.Vector();
 						Projectile->InitVelocity(LaunchDir);
+						//kills are credited to the ship that fired
+						Projectile->SetOwner(this);
 						m_fShotCooldown = m_GameMode->GetParameters()->fTimeBetweenShots;
 
 						//shooting costs fitness
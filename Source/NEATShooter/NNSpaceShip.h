@@ -132,6 +132,7 @@ public:
 	double GetFitness()const { return m_dFitness; }
 	int GetCurrentHealth() { return m_iHealth; }
 	void AssignNeuralNet(UNeuralNet* neuralNet) { m_NeuralNet = neuralNet; }
+	UNeuralNet* GetNeuralNet() { return m_NeuralNet; }
 	void AssignGenotype(UGenome* genotype) { m_Genotype = genotype; }
 	UGenome* GetGenotype() { return m_Genotype; }
 };
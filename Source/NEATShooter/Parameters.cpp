@@ -13,6 +13,7 @@
 //limitations under the License.
 
 #include "Parameters.h"
+#include "Globals.h"
 
 
 
@@ -20,6 +21,12 @@ UParameters::UParameters()
 {
 	iPopulationSize = 100;
 	iNumTriesForSelection = 20;
+	bSteadyStateMode = false;
+	iSteadyStateInterval = 5;
+	iNumIslands = 1;
+	iMigrationInterval = 10;
+	iNumMigrants = 2;
+	bRandomMigration = false;
 	iNumBestOrganisms = 5;
 	iNumInputLines = 2;
 	iNumInputRows = 10;
@@ -46,11 +53,14 @@ UParameters::UParameters()
 	dOldAgePenalty = 0.15;
 	iNumGensAllowedNoImprovement = 25;
 	dSurvivalRate = 0.4;
+	fEpochFrameBudgetMs = 5.f;
+	iParentSelection = truncation;
 
 	iMaxPermittedNeurons = 600;
 
 	dCrossoverRate = 0.75;
 	iCrossoverTries = 5;
+	iRandomSeed = 1;
 
 	iSpeciesTarget = 15;
 
@@ -58,12 +68,41 @@ UParameters::UParameters()
 	dToggleLinkRate = 0.1;
 	dEnableLinkRate = 0.1;
 
+	bBitsetCompatibility = true;
+	iCompatibilityCacheSize = 65536;
+	bNearestSpeciesMatch = false;
 	dExcessCoeff = 1;
 	dDisjointCoeff = 1;
 	dMatchingCoeff = 0.4;
 
 	fTimeLeftToPlay = 20.f;
+	iNumLanes = 1;
+	bHeadlessTraining = false;
+	fHeadlessTimeStep = 1.f / 60.f;
+	bParallelEvaluation = true;
+	iNumScenarios = 32;
+	iGenerationsPerScenario = 1;
+	iMinEpisodesPerGenome = 1;
+	iMaxEpisodesPerGenome = 1;
+	fEpisodeBudgetPerGenome = 1.f;
+	fEpisodeConfidenceZ = 1.96f;
+	bForkedEvaluation = false;
+	iNumHardStates = 8;
+	iHardStateMinBodies = 6;
+	fHardStateSpacing = 3.f;
+	fForkDuration = 4.f;
+	fForkFitnessWeight = 1.f;
+	bFitnessCache = false;
+	bAverageCachedFitness = false;
+	bVerifyFitnessCache = false;
+	bFixedStepSimulation = false;
+	fFixedTimeStep = 1.f / 60.f;
+	fFixedStepFrameBudgetMs = 12.f;
 	fFitnessCutoff = -200.f;
+	bEarlyTermination = false;
+	fRaceCheckpointInterval = 5.f;
+	fRaceBand = 0.25f;
+	iRaceMinSamples = 10;
 	fFitnessPerSecond = 25.f;
 	fFitnessPerShot = 50.f;
 	fNetMovementRequired = 150.f;
@@ -80,6 +80,19 @@ public:
 		//indicates how similar genomes need to be to belong to the same species. Smaller means more species will be created
 		double dCompatibilityThreshold;
 
+	UPROPERTY(Config, EditAnywhere)
+		//compare genomes on bitsets of their innovations during speciation. Same result, faster for big overlapping genomes
+		bool bBitsetCompatibility;
+
+	UPROPERTY(Config, EditAnywhere)
+		//false: a genome joins the first species in the list it is compatible with (original NEAT).
+		//true: it joins the compatible species with the closest leader, ties going to the older species. Changes the species
+		bool bNearestSpeciesMatch;
+
+	UPROPERTY(Config, EditAnywhere)
+		//number of compatibility results between genome contents kept over the generations. 0 disables the cache
+		int iCompatibilityCacheSize;
+
 	UPROPERTY(Config, EditAnywhere)
 		//used in calculating the compatibility score
 		double dExcessCoeff;
@@ -102,13 +115,20 @@ public:
 		double dOldAgePenalty;
 
 	UPROPERTY(Config, EditAnywhere)
-		//percentage from which the member of a species get selected for the next generation. (0.2 = 20%) Don't put this above 80% or array index invalid
+		//percentage from which the member of a species get selected for the next generation. (0.2 = 20%)
 		double dSurvivalRate;
+	UPROPERTY(Config, EditAnywhere)
+		//how parents are drawn from the survivors. 0 = truncation (uniform), 1 = fitness proportional, 2 = rank based
+		int iParentSelection;
 
 	UPROPERTY(Config, EditAnywhere)
 		//how long we allow a species to exist without any improvement
 		int iNumGensAllowedNoImprovement;
 
+	UPROPERTY(Config, EditAnywhere)
+		//milliseconds per frame the next generation may be built in, the rest is done in the following frames. 0 = whole epoch in one frame
+		float fEpochFrameBudgetMs;
+
 	UPROPERTY(Config, EditAnywhere)
 		//maximum number of neurons permitted in the network
 		int iMaxPermittedNeurons;
@@ -120,6 +140,11 @@ public:
 		//amount of tries to find different crossover partner
 		int iCrossoverTries;
 
+	UPROPERTY(Config, EditAnywhere)
+		//seed of the random streams the children are mutated with. Together with the generation and the child's position it
+		//decides every mutation, independent of which thread carries it out
+		int iRandomSeed;
+
 	UPROPERTY(Config, EditAnywhere)
 		//max desired amount of species. set to 0 to disable threshold adjustment feature
 		int iSpeciesTarget;
@@ -128,14 +153,117 @@ public:
 		//amount of tries for tournament selection after which the winner is selected out of the entire population. Change depending on population size
 		int iNumTriesForSelection;
 
+	UPROPERTY(Config, EditAnywhere)
+		//rtNEAT: no generations, every finished run goes straight to the GA and after every iSteadyStateInterval runs
+		//the worst genome is replaced by a new offspring. Species are assigned one genome at a time
+		bool bSteadyStateMode;
+	UPROPERTY(Config, EditAnywhere)
+		//runs between two replacements in steady state mode
+		int iSteadyStateInterval;
+
+	UPROPERTY(Config, EditAnywhere)
+		//splits the population into this many islands that evolve separately (generational mode only). 1 = one population
+		int iNumIslands;
+	UPROPERTY(Config, EditAnywhere)
+		//generations between two migrations
+		int iMigrationInterval;
+	UPROPERTY(Config, EditAnywhere)
+		//best genomes each island sends out per migration. They replace the worst genomes of the receiving island
+		int iNumMigrants;
+	UPROPERTY(Config, EditAnywhere)
+		//false: island i sends to island i + 1 (ring). true: each island sends to a random other island
+		bool bRandomMigration;
+
 	UPROPERTY(Config, EditAnywhere)
 		//time each player gets to play
 		float fTimeLeftToPlay;
 
+	UPROPERTY(Config, EditAnywhere)
+		//ships playing at the same time in the level, each in its own copy of the play area next to the first one
+		int iNumLanes;
+
+	UPROPERTY(Config, EditAnywhere)
+		//true: every generation is played out in the headless simulation instead of the level, the level only shows the best ships
+		bool bHeadlessTraining;
+	UPROPERTY(Config, EditAnywhere)
+		//fixed step of the headless simulation in seconds
+		float fHeadlessTimeStep;
+	UPROPERTY(Config, EditAnywhere)
+		//headless episodes of a generation are played on all cores. Off plays them one after the other with the same results
+		bool bParallelEvaluation;
+	UPROPERTY(Config, EditAnywhere)
+		//number of enemy spawn schedules the generations take turns with, drawn from iRandomSeed at the start
+		int iNumScenarios;
+	UPROPERTY(Config, EditAnywhere)
+		//the scenario changes only every this many generations, genomes carried over in between keep their fitness
+		int iGenerationsPerScenario;
+	UPROPERTY(Config, EditAnywhere)
+		//headless episodes every genome plays per generation, each in another scenario
+		int iMinEpisodesPerGenome;
+	UPROPERTY(Config, EditAnywhere)
+		//genomes close to the survival cut may play up to this many episodes
+		int iMaxEpisodesPerGenome;
+	UPROPERTY(Config, EditAnywhere)
+		//average number of headless episodes a generation may spend per genome
+		float fEpisodeBudgetPerGenome;
+	UPROPERTY(Config, EditAnywhere)
+		//a genome gets another episode while its mean is less than this many standard errors away from the survival cut
+		float fEpisodeConfidenceZ;
+	UPROPERTY(Config, EditAnywhere)
+		//true: every genome is also forked from crowded moments of the best net's runs and gets the fitness it gained there
+		bool bForkedEvaluation;
+	UPROPERTY(Config, EditAnywhere)
+		//number of crowded moments the genomes are forked from
+		int iNumHardStates;
+	UPROPERTY(Config, EditAnywhere)
+		//destructibles, enemies and projectiles that have to be on screen for a moment to count as crowded
+		int iHardStateMinBodies;
+	UPROPERTY(Config, EditAnywhere)
+		//minimum seconds between two moments captured in the same run
+		float fHardStateSpacing;
+	UPROPERTY(Config, EditAnywhere)
+		//seconds every fork is played
+		float fForkDuration;
+	UPROPERTY(Config, EditAnywhere)
+		//weight of the mean fork fitness added to the episode fitness
+		float fForkFitnessWeight;
+	UPROPERTY(Config, EditAnywhere)
+		//true: genomes that already played the headless scenario are not played again
+		bool bFitnessCache;
+	UPROPERTY(Config, EditAnywhere)
+		//true: a cached genome gets the mean fitness of all scenarios it played while it survived
+		bool bAverageCachedFitness;
+	UPROPERTY(Config, EditAnywhere)
+		//debugging: cache hits are played anyway and a replay that doesn't match the cached fitness is reported
+		bool bVerifyFitnessCache;
+
+	UPROPERTY(Config, EditAnywhere)
+		//true: the level is advanced in steps of fFixedTimeStep instead of the frame time, so results do not depend on the speed or frame rate
+		bool bFixedStepSimulation;
+	UPROPERTY(Config, EditAnywhere)
+		//length of one fixed step in seconds
+		float fFixedTimeStep;
+	UPROPERTY(Config, EditAnywhere)
+		//milliseconds per rendered frame the fixed steps may take. Steps that do not fit are dropped and the game runs slower
+		float fFixedStepFrameBudgetMs;
+
 	UPROPERTY(Config, EditAnywhere)
 		//below this fitness value the current player gets his run terminated
 		float fFitnessCutoff;
 
+	UPROPERTY(Config, EditAnywhere)
+		//true: runs that fall clearly behind the runs of the generation that were already played are stopped early
+		bool bEarlyTermination;
+	UPROPERTY(Config, EditAnywhere)
+		//seconds between the checkpoints the runs are compared at
+		float fRaceCheckpointInterval;
+	UPROPERTY(Config, EditAnywhere)
+		//only runs in this lower share of the fitness at a checkpoint can be stopped there
+		float fRaceBand;
+	UPROPERTY(Config, EditAnywhere)
+		//finished runs that must have passed a checkpoint before runs are stopped at it
+		int iRaceMinSamples;
+
 	UPROPERTY(Config, EditAnywhere)
 		//how much fitness is rewarded for each survived second
 		float fFitnessPerSecond;
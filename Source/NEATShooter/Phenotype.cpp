@@ -13,26 +13,149 @@
 //limitations under the License.
 
 #include "Phenotype.h"
+#include "Genotype.h"
+#include "GenerationArena.h"
 
 
 
 
 UNeuralNet::UNeuralNet()
 {
-	m_Neurons.Empty();
+	m_Neurons = nullptr;
+	m_iNumNeurons = 0;
+	m_Links = nullptr;
+	m_iNumLinks = 0;
+	m_Arena = nullptr;
+	m_iArenaResetCount = 0;
 	m_iDepth = 0;
 }
 
-void UNeuralNet::Initialize(TArray<UNeuron*> neurons, int depth)
+void UNeuralNet::Initialize(const TArray<FSNeuronGene> &neurons, const TArray<FSLinkGene> &links, int depth, FGenerationArena* arena)
 {
-	m_Neurons = neurons;
 	m_iDepth = depth;
+	m_Arena = arena;
+
+	//position of each neuron ID in the neuron array
+	TMap<int, int> NeuronPos;
+	NeuronPos.Reserve(neurons.Num());
+
+	m_iNumNeurons = neurons.Num();
+	m_iNumLinks = 0;
+	for (const FSLinkGene& curLink : links)
+	{
+		if (curLink.bEnabled)
+		{
+			++m_iNumLinks;
+		}
+	}
+
+	if (m_Arena)
+	{
+		m_iArenaResetCount = m_Arena->GetResetCount();
+		m_Neurons = arena->AllocateArray<FSNetNeuron>(m_iNumNeurons);
+		m_Links = arena->AllocateArray<FSNetLink>(m_iNumLinks);
+	}
+	else
+	{
+		m_OwnedNeurons.SetNum(m_iNumNeurons);
+		m_OwnedLinks.SetNum(m_iNumLinks);
+		m_Neurons = m_OwnedNeurons.GetData();
+		m_Links = m_OwnedLinks.GetData();
+	}
+
+	//create all the required neurons
+	for (int i = 0; i < m_iNumNeurons; ++i)
+	{
+		m_Neurons[i].NeuronType = neurons[i].NeuronType;
+		m_Neurons[i].iNeuronID = neurons[i].iID;
+		m_Neurons[i].dSplitX = neurons[i].dSplitX;
+		m_Neurons[i].dSplitY = neurons[i].dSplitY;
+		m_Neurons[i].dOutput = 0;
+		NeuronPos.Add(neurons[i].iID, i);
+	}
+
+	//count the incoming links of every neuron, then give every neuron its range in the link array
+	for (const FSLinkGene& curLink : links)
+	{
+		if (curLink.bEnabled)
+		{
+			++m_Neurons[NeuronPos.FindChecked(curLink.ToNeuron)].iNumLinksIn;
+		}
+	}
+
+	int NextFreeLink = 0;
+	for (int i = 0; i < m_iNumNeurons; ++i)
+	{
+		m_Neurons[i].iFirstLinkIn = NextFreeLink;
+		NextFreeLink += m_Neurons[i].iNumLinksIn;
+		//used as fill counter below
+		m_Neurons[i].iNumLinksIn = 0;
+	}
+
+	//create the links. Every neuron keeps its incoming links in gene order
+	for (const FSLinkGene& curLink : links)
+	{
+		//make sure the link gene is enabled before the connection is created
+		if (curLink.bEnabled)
+		{
+			FSNetNeuron& ToNeuron = m_Neurons[NeuronPos.FindChecked(curLink.ToNeuron)];
+			FSNetLink& NewLink = m_Links[ToNeuron.iFirstLinkIn + ToNeuron.iNumLinksIn];
+
+			NewLink.iFromNeuron = NeuronPos.FindChecked(curLink.FromNeuron);
+			NewLink.dWeight = curLink.dWeight;
+			NewLink.bRecurrent = curLink.bRecurrent;
+			++ToNeuron.iNumLinksIn;
+		}
+	}
+}
+
+bool UNeuralNet::IsUsable() const
+{
+	return (m_Arena == nullptr) || (m_Arena->GetResetCount() == m_iArenaResetCount);
+}
+
+void UNeuralNet::CaptureActivations(TArray<FSNeuronActivation> &outActivations) const
+{
+	outActivations.Reset(m_iNumNeurons);
+	for (int i = 0; i < m_iNumNeurons; ++i)
+	{
+		outActivations.Add(FSNeuronActivation(m_Neurons[i].iNeuronID, m_Neurons[i].dOutput));
+	}
+}
+
+void UNeuralNet::RestoreActivations(const TArray<FSNeuronActivation> &activations)
+{
+	TMap<int, double> OutputOfNeuron;
+	OutputOfNeuron.Reserve(activations.Num());
+	for (const FSNeuronActivation &curActivation : activations)
+	{
+		OutputOfNeuron.Add(curActivation.iNeuronID, curActivation.dOutput);
+	}
+
+	for (int i = 0; i < m_iNumNeurons; ++i)
+	{
+		m_Neurons[i].dOutput = OutputOfNeuron.FindRef(m_Neurons[i].iNeuronID);
+	}
+}
+
+void UNeuralNet::ResetActivations()
+{
+	for (int i = 0; i < m_iNumNeurons; ++i)
+	{
+		m_Neurons[i].dOutput = 0;
+	}
 }
 
 TArray<double> UNeuralNet::Update(TArray<double>& vInputs, run_type runType)
 {
 	TArray<double> outputs;
 
+	if (!IsUsable())
+	{
+		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("Phenotype Update called on a net from an old generation"));
+		return outputs;
+	}
+
 	int IterationCount = 0;
 
 	if (runType == snapshot)
@@ -46,44 +169,45 @@ TArray<double> UNeuralNet::Update(TArray<double>& vInputs, run_type runType)
 
 	for (int i = 0; i < IterationCount; ++i)
 	{
-		outputs.Empty();
+		outputs.Reset();
 		int CurrentNeuron = 0;
 
 		//set output of input-neurons to inputs from the input list
-		for (int i = CurrentNeuron; i < m_Neurons.Num(); ++i)
+		for (int i = CurrentNeuron; i < m_iNumNeurons; ++i)
 		{
-			if (m_Neurons[i]->m_NeuronType == input)
+			if (m_Neurons[i].NeuronType == input)
 			{
-				m_Neurons[i]->m_dOutput = vInputs[CurrentNeuron];
+				m_Neurons[i].dOutput = vInputs[CurrentNeuron];
 				++CurrentNeuron;
 			}
 
 			//set output of bias neuron
-			if (m_Neurons[i]->m_NeuronType == bias)
+			if (m_Neurons[i].NeuronType == bias)
 			{
-				m_Neurons[i]->m_dOutput = 1;
+				m_Neurons[i].dOutput = 1;
 				++CurrentNeuron;
 			}
 		}
 
 		//now outputs and hidden neurons are calculated
-		while (CurrentNeuron < m_Neurons.Num())
+		while (CurrentNeuron < m_iNumNeurons)
 		{
+			FSNetNeuron& curNeuron = m_Neurons[CurrentNeuron];
+			const FSNetLink* LinksIn = m_Links + curNeuron.iFirstLinkIn;
+
 			double sum = 0;
 			//calculate sum by going through all incomming links
-			for (int i = 0; i < m_Neurons[CurrentNeuron]->m_LinksIn.Num(); ++i)
+			for (int i = 0; i < curNeuron.iNumLinksIn; ++i)
 			{
-				double LinkWeight = m_Neurons[CurrentNeuron]->m_LinksIn[i]->m_dLinkWeight;
-				double NeuronOutput = m_Neurons[CurrentNeuron]->m_LinksIn[i]->m_InputNeuron->m_dOutput;
-				sum += LinkWeight * NeuronOutput;
+				sum += LinksIn[i].dWeight * m_Neurons[LinksIn[i].iFromNeuron].dOutput;
 			}
 
 			//assign outputs
-			m_Neurons[CurrentNeuron]->m_dOutput = Sigmoid(sum);
+			curNeuron.dOutput = Sigmoid(sum);
 
-			if (m_Neurons[CurrentNeuron]->m_NeuronType == output)
+			if (curNeuron.NeuronType == output)
 			{
-				outputs.Add(m_Neurons[CurrentNeuron]->m_dOutput);
+				outputs.Add(curNeuron.dOutput);
 			}
 
 			++CurrentNeuron;
@@ -96,31 +220,11 @@ TArray<double> UNeuralNet::Update(TArray<double>& vInputs, run_type runType)
 	 //presented
 	if (runType == snapshot)
 	{
-		for (UNeuron* curNeuron : m_Neurons)
+		for (int i = 0; i < m_iNumNeurons; ++i)
 		{
-			curNeuron->m_dOutput = 0;
+			m_Neurons[i].dOutput = 0;
 		}
 	}
 
 	return outputs;
 }
-
-void ULink::Initialize(UNeuron * input, UNeuron * output, double dWeight, bool bIsRec)
-{
-	m_InputNeuron = input;
-	m_OutputNeuron = output;
-	m_dLinkWeight = dWeight;
-	m_bIsRecurrent = bIsRec;
-}
-
-void UNeuron::Initialize(neuron_type type, int id, double splitX, double splitY)
-{
-	m_NeuronType = type;
-	m_iNeuronID = id;
-	m_dActivationSum = 0;
-	m_dOutput = 0;
-	m_iPosX = 0;
-	m_iPosY = 0;
-	m_dSplitX = splitX;
-	m_dSplitY = splitY;
-}
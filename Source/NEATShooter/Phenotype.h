@@ -21,83 +21,90 @@
 #include "Phenotype.generated.h"
 
 
-class ULink;
+class FGenerationArena;
+struct FSNeuronGene;
+struct FSLinkGene;
 
 
-//The neuron structure class
-UCLASS()
-class NEATSHOOTER_API UNeuron : public UObject
+//Neuron of the compiled network. Its incoming links are stored back to back starting at iFirstLinkIn
+struct FSNetNeuron
 {
-	GENERATED_BODY()
-
-	//public because architecture of UE4. Need access to modify object directly
-public:
-	UPROPERTY()
-		TArray<ULink*> m_LinksIn;
-	UPROPERTY()
-		TArray<ULink*> m_LinksOut;
-
-	UPROPERTY()
-		int m_iNeuronID;
-	UPROPERTY()
-		double m_dActivationSum;
-	UPROPERTY()
-		double m_dOutput;
-
-	UPROPERTY()
-		TEnumAsByte<neuron_type> m_NeuronType;
-
-	UPROPERTY()
-		int m_iPosX;
-	UPROPERTY()
-		int m_iPosY;
-	UPROPERTY()
-		double m_dSplitX;
-	UPROPERTY()
-		double m_dSplitY;
-
-	UNeuron() {}
-	void Initialize(neuron_type type, int id, double splitX, double splitY);
+	double dOutput;
+	int iNeuronID;
+	int iFirstLinkIn;
+	int iNumLinksIn;
+	neuron_type NeuronType;
+	double dSplitX;
+	double dSplitY;
+
+	FSNetNeuron() : dOutput(0), iNeuronID(-1), iFirstLinkIn(0), iNumLinksIn(0), NeuronType(noType), dSplitX(0), dSplitY(0) {}
 };
 
-//The link structure class
-UCLASS()
-class NEATSHOOTER_API ULink : public UObject
+//Link of the compiled network, stored with the neuron it leads into
+struct FSNetLink
 {
-	GENERATED_BODY()
+	//position of the input neuron in the neuron array of the net
+	int iFromNeuron;
+	double dWeight;
+	bool bRecurrent;
 
-	//public because architecture of UE4. Need access to modify object directly
-public:
-	UPROPERTY()
-		UNeuron* m_InputNeuron;
-	UPROPERTY()
-		UNeuron* m_OutputNeuron;
+	FSNetLink() : iFromNeuron(-1), dWeight(0), bRecurrent(false) {}
+};
 
-	UPROPERTY()
-		double m_dLinkWeight;
-	UPROPERTY()
-		bool m_bIsRecurrent;
+//Output of one neuron, kept with its ID so it can be given back to a net with other neurons
+struct FSNeuronActivation
+{
+	int iNeuronID;
+	double dOutput;
 
-	ULink() {}
-	void Initialize(UNeuron* input, UNeuron* output, double dWeight, bool bIsRec);
+	FSNeuronActivation() : iNeuronID(-1), dOutput(0) {}
+	FSNeuronActivation(int neuronID, double output) : iNeuronID(neuronID), dOutput(output) {}
 };
 
-//The phenotype for our organisms
+//The phenotype for our organisms. Neurons and links are flat arrays, either allocated in the generation arena of the
+//genetic algorithm or, if no arena is given, owned by the net itself
 UCLASS()
 class NEATSHOOTER_API UNeuralNet : public UObject
 {
 	GENERATED_BODY()
 	
 private:
-	UPROPERTY()
-		TArray<UNeuron*> m_Neurons;
+	FSNetNeuron* m_Neurons;
+	int m_iNumNeurons;
+	FSNetLink* m_Links;
+	int m_iNumLinks;
+
+	//storage for nets that have to outlive a generation
+	TArray<FSNetNeuron> m_OwnedNeurons;
+	TArray<FSNetLink> m_OwnedLinks;
+
+	//arena the net lives in and its reset count at compile time. If they differ the memory is gone
+	const FGenerationArena* m_Arena;
+	uint32 m_iArenaResetCount;
+
 	UPROPERTY()
 		int m_iDepth;
 
 public:
 	UNeuralNet();
-	void Initialize(TArray<UNeuron*> neurons, int depth);
+	//Compiles the net from the genes of a genome. Disabled links are left out
+	void Initialize(const TArray<FSNeuronGene> &neurons, const TArray<FSLinkGene> &links, int depth, FGenerationArena* arena = nullptr);
 
 	//Ppdate network for this tick
 	TArray<double> Update(TArray<double> &vInputs, run_type runType);
+
+	//False if the arena the net was compiled into has been reset since
+	bool IsUsable() const;
+
+	//Copies the outputs of all neurons. Recurrent links read them in the next update, so they are part of the state of a run
+	void CaptureActivations(TArray<FSNeuronActivation> &outActivations) const;
+	//Gives the neurons with the same ID their captured output back, all others start at 0
+	void RestoreActivations(const TArray<FSNeuronActivation> &activations);
+	//Sets the outputs of all neurons to 0, a new run must not start with what the last one left in the recurrent links
+	void ResetActivations();
+
+
+
+	int GetNumNeurons() const { return m_iNumNeurons; }
+	int GetNumLinks() const { return m_iNumLinks; }
 };
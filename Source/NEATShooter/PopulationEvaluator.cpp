@@ -0,0 +1,109 @@
+//Copyright 2018 Raphael Haucke
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+//http ://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+
+#include "PopulationEvaluator.h"
+#include "Parameters.h"
+#include "Phenotype.h"
+#include "Async/ParallelFor.h"
+
+
+
+FPopulationEvaluator::FPopulationEvaluator()
+{
+	m_Parameters = nullptr;
+}
+
+void FPopulationEvaluator::Initialize(const UParameters* parameters, const FNNInputGrid &grid, const FSpawnZone &spawnZone, FVector2D playerStartPosition)
+{
+	m_Parameters = parameters;
+	m_Template.Initialize(parameters, grid, spawnZone, playerStartPosition);
+	m_Simulations.Reset();
+}
+
+void FPopulationEvaluator::Evaluate(const TArray<UNeuralNet*> &nets, const FScenario &scenario, TArray<double> &outFitness)
+{
+	TArray<const FScenario*> Scenarios;
+	Scenarios.Init(&scenario, nets.Num());
+	Evaluate(nets, Scenarios, outFitness);
+}
+
+void FPopulationEvaluator::Evaluate(const TArray<UNeuralNet*> &nets, const TArray<const FScenario*> &scenarios, TArray<double> &outFitness)
+{
+	while (m_Simulations.Num() < nets.Num())
+	{
+		m_Simulations.Add(m_Template);
+	}
+	outFitness.SetNumZeroed(nets.Num());
+
+	//the simulations can't show errors from the worker threads, so they are checked here
+	if (m_Parameters->fHeadlessTimeStep <= 0.f)
+	{
+		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("PopulationEvaluator Evaluate fHeadlessTimeStep has to be positive"));
+		return;
+	}
+
+	ParallelFor(nets.Num(), [&](int32 NetIndex)
+	{
+		outFitness[NetIndex] = m_Simulations[NetIndex].Run(nets[NetIndex], *scenarios[NetIndex]);
+	}, !m_Parameters->bParallelEvaluation);
+
+	for (int i = 0; i < nets.Num(); ++i)
+	{
+		if (m_Simulations[i].HasFailed())
+		{
+			GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("PopulationEvaluator Evaluate a net couldn't play its episode"));
+			break;
+		}
+	}
+}
+
+void FPopulationEvaluator::EvaluateForks(const TArray<UNeuralNet*> &nets, const TArray<FSSimSnapshot> &states, TArray<double> &outFitness)
+{
+	while (m_Simulations.Num() < nets.Num())
+	{
+		m_Simulations.Add(m_Template);
+	}
+	outFitness.SetNumZeroed(nets.Num());
+
+	if (states.Num() == 0)
+	{
+		return;
+	}
+
+	if (m_Parameters->fHeadlessTimeStep <= 0.f)
+	{
+		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("PopulationEvaluator EvaluateForks fHeadlessTimeStep has to be positive"));
+		return;
+	}
+
+	//every net writes only its own slot
+	TArray<bool> Failed;
+	Failed.Init(false, nets.Num());
+
+	ParallelFor(nets.Num(), [&](int32 NetIndex)
+	{
+		double Gained = 0.0;
+		for (const FSSimSnapshot &curState : states)
+		{
+			Gained += m_Simulations[NetIndex].RunFork(nets[NetIndex], curState, m_Parameters->fForkDuration);
+			Failed[NetIndex] = Failed[NetIndex] || m_Simulations[NetIndex].HasFailed();
+		}
+		outFitness[NetIndex] = Gained / states.Num();
+	}, !m_Parameters->bParallelEvaluation);
+
+	if (Failed.Contains(true))
+	{
+		GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, TEXT("PopulationEvaluator EvaluateForks a net couldn't play its forks"));
+	}
+}
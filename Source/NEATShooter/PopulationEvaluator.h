@@ -0,0 +1,55 @@
+//Copyright 2018 Raphael Haucke
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+//http ://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+
+#pragma once
+
+#include "HeadlessSimulation.h"
+
+#include "CoreMinimal.h"
+
+
+class UNeuralNet;
+class UParameters;
+
+
+//Plays the episodes of a whole population in the headless simulation on the task graph. Every net gets its own simulation
+//and writes only its own fitness slot, so the result depends on the scenario and never on how the work was split between threads
+class NEATSHOOTER_API FPopulationEvaluator
+{
+private:
+	const UParameters* m_Parameters;
+
+	//the template every simulation is copied from
+	FHeadlessSimulation m_Template;
+
+	//one per net, kept between generations to reuse their memory
+	TArray<FHeadlessSimulation> m_Simulations;
+
+public:
+	FPopulationEvaluator();
+
+	void Initialize(const UParameters* parameters, const FNNInputGrid &grid, const FSpawnZone &spawnZone, FVector2D playerStartPosition);
+
+	//Plays one episode per net and writes the fitness of net i into outFitness[i]. All nets play the same scenario.
+	//Nets must not appear twice since their activations are changed while they play
+	void Evaluate(const TArray<UNeuralNet*> &nets, const FScenario &scenario, TArray<double> &outFitness);
+	//Same, but net i plays scenarios[i]
+	void Evaluate(const TArray<UNeuralNet*> &nets, const TArray<const FScenario*> &scenarios, TArray<double> &outFitness);
+
+	//Forks every net from every state for fForkDuration seconds and writes the mean fitness net i gained into outFitness[i]
+	void EvaluateForks(const TArray<UNeuralNet*> &nets, const TArray<FSSimSnapshot> &states, TArray<double> &outFitness);
+
+	//The simulation net i played in during the last Evaluate
+	const FHeadlessSimulation& GetSimulation(int index) const { return m_Simulations[index]; }
+};
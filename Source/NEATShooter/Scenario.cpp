@@ -0,0 +1,109 @@
+//Copyright 2018 Raphael Haucke
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+//http ://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+
+#include "Scenario.h"
+#include "Parameters.h"
+
+
+
+const int FScenario::NumSpawnPoints = 10;
+
+FScenario::FScenario()
+{
+	m_Seed = 0;
+	m_fLength = 0.f;
+}
+
+void FScenario::Generate(int32 seed, const UParameters* parameters)
+{
+	m_Seed = seed;
+	m_fLength = parameters->fTimeLeftToPlay;
+	m_Destructibles.Reset();
+	m_Enemies.Reset();
+
+	FRandomStream Random(seed);
+
+	//first spawns at the times the level always started with
+	for (float Time = 0.5f; Time < m_fLength; Time += FMath::Max(parameters->fSpawnTimeDestructible, 0.01f))
+	{
+		FSSpawnEvent Destructible;
+		Destructible.fTime = Time;
+		Destructible.iSpawnPoint = RandInt(Random, 1, NumSpawnPoints);
+		Destructible.fVertSpeed = Random.FRandRange(200.0f, 500.0f);
+		m_Destructibles.Add(Destructible);
+	}
+
+	for (float Time = 1.5f; Time < m_fLength; Time += FMath::Max(parameters->fSpawnTimeEnemyShip, 0.01f))
+	{
+		FSSpawnEvent EnemyShip;
+		EnemyShip.fTime = Time;
+		EnemyShip.iSpawnPoint = RandInt(Random, 1, NumSpawnPoints);
+		EnemyShip.fVertSpeed = Random.FRandRange(100.0f, 300.0f);
+
+		float Sign = Random.FRandRange(0.0f, 2.0f);
+		EnemyShip.fHorizSpeed = Random.FRandRange(100.0f, 300.0f);
+		if (Sign < 1.0f)
+		{
+			EnemyShip.fHorizSpeed *= -1.0f;
+		}
+		m_Enemies.Add(EnemyShip);
+	}
+}
+
+const FSSpawnEvent* FScenario::PopDueEvent(const TArray<FSSpawnEvent> &schedule, float &time, int &nextEvent) const
+{
+	//players that go on past the end, like the best ships, see the scenario again
+	if (nextEvent >= schedule.Num() && m_fLength > 0.f && time >= m_fLength)
+	{
+		time -= m_fLength;
+		nextEvent = 0;
+	}
+
+	if (schedule.IsValidIndex(nextEvent) && schedule[nextEvent].fTime <= time)
+	{
+		return &schedule[nextEvent++];
+	}
+	return nullptr;
+}
+
+const FSSpawnEvent* FScenario::PopDestructible(FSScenarioCursor &cursor) const
+{
+	return PopDueEvent(m_Destructibles, cursor.fDestructibleTime, cursor.iNextDestructible);
+}
+
+const FSSpawnEvent* FScenario::PopEnemy(FSScenarioCursor &cursor) const
+{
+	return PopDueEvent(m_Enemies, cursor.fEnemyTime, cursor.iNextEnemy);
+}
+
+float FScenario::GetSpawnY(const FSpawnZone &spawnZone, int spawnPoint)
+{
+	float Range = spawnZone.m_RightY - spawnZone.m_LeftY;
+	float PointWidth = Range / NumSpawnPoints;
+	return spawnZone.m_LeftY + spawnPoint * PointWidth - PointWidth * 0.5f;
+}
+
+
+
+void FScenarioLibrary::Build(const UParameters* parameters)
+{
+	int NumScenarios = FMath::Max(1, parameters->iNumScenarios);
+
+	m_Scenarios.Reset();
+	m_Scenarios.SetNum(NumScenarios);
+	for (int i = 0; i < NumScenarios; ++i)
+	{
+		m_Scenarios[i].Generate(int32(HashCombine(GetTypeHash(parameters->iRandomSeed), GetTypeHash(i))), parameters);
+	}
+}
@@ -0,0 +1,99 @@
+//Copyright 2018 Raphael Haucke
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+//http ://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+
+#pragma once
+
+#include "Globals.h"
+
+#include "CoreMinimal.h"
+
+
+class UParameters;
+
+
+//One spawn of a scenario. The spawn point is counted inside the spawn zone, so the same event fits every lane
+struct FSSpawnEvent
+{
+	//seconds into the run
+	float fTime;
+	int iSpawnPoint;
+	float fVertSpeed;
+	//enemies only, negative moves towards the left
+	float fHorizSpeed;
+
+	FSSpawnEvent() : fTime(0.f), iSpawnPoint(1), fVertSpeed(0.f), fHorizSpeed(0.f) {}
+};
+
+//Where a player of a scenario stands. Both schedules keep their own clock like the spawn timers did
+struct FSScenarioCursor
+{
+	float fDestructibleTime;
+	int iNextDestructible;
+	float fEnemyTime;
+	int iNextEnemy;
+
+	FSScenarioCursor() : fDestructibleTime(0.f), iNextDestructible(0), fEnemyTime(0.f), iNextEnemy(0) {}
+};
+
+//The enemy spawns of one run, drawn from a seed before it starts. Every ship that plays it meets the same enemies at the
+//same time, no matter in which lane, in the level or in the headless simulation
+class NEATSHOOTER_API FScenario
+{
+private:
+	int32 m_Seed;
+
+	//both sorted by time
+	TArray<FSSpawnEvent> m_Destructibles;
+	TArray<FSSpawnEvent> m_Enemies;
+
+	//the schedules start over after this many seconds
+	float m_fLength;
+
+	//Hands out the events of the schedule that are due one by one, nullptr once none is left
+	const FSSpawnEvent* PopDueEvent(const TArray<FSSpawnEvent> &schedule, float &time, int &nextEvent) const;
+
+public:
+	//Feature: Edit in Editor, don't hardcode
+	static const int NumSpawnPoints;
+
+	FScenario();
+
+	//Draws the schedules for a run of fTimeLeftToPlay seconds with the spawn times of the parameters
+	void Generate(int32 seed, const UParameters* parameters);
+
+	//Returns the next destructible the cursor has reached or nullptr. The caller advances fDestructibleTime
+	const FSSpawnEvent* PopDestructible(FSScenarioCursor &cursor) const;
+	//Same for the enemy ships and fEnemyTime
+	const FSSpawnEvent* PopEnemy(FSScenarioCursor &cursor) const;
+
+	//Y of the spawn point, spread evenly over the zone
+	static float GetSpawnY(const FSpawnZone &spawnZone, int spawnPoint);
+
+	int32 GetSeed() const { return m_Seed; }
+};
+
+//The scenarios a run can play, one per generation in turn. Built once from the seed of the parameters
+class NEATSHOOTER_API FScenarioLibrary
+{
+private:
+	TArray<FScenario> m_Scenarios;
+
+public:
+	void Build(const UParameters* parameters);
+
+	//Wraps around, so every index is valid
+	const FScenario& Get(int index) const { return m_Scenarios[index % m_Scenarios.Num()]; }
+
+	int Num() const { return m_Scenarios.Num(); }
+};
@@ -63,20 +63,57 @@ void USpecies::AdjustFitnessScores()
 
 void USpecies::AddMember(UGenome *newGenome)
 {
-	if (newGenome->GetFitness() > m_dBestFitness)
+	UpdateLeader(newGenome);
+	newGenome->SetSpecies(m_iSpeciesID);
+	m_Members.Add(newGenome);
+}
+
+void USpecies::RemoveMember(UGenome *genome)
+{
+	m_Members.Remove(genome);
+}
+
+void USpecies::UpdateLeader(UGenome *genome)
+{
+	if (genome->GetFitness() > m_dBestFitness)
 	{
-		m_dBestFitness = newGenome->GetFitness();
+		m_dBestFitness = genome->GetFitness();
 		m_iGensNoImprovement = 0;
-		m_Leader = newGenome;
+		m_Leader = genome;
 	}
-	newGenome->SetSpecies(m_iSpeciesID);
-	m_Members.Add(newGenome);
+}
+
+void USpecies::FinalizeMembers()
+{
 	m_Members.Sort();
+
+	//the top members survive, at least one and never more than there are
+	int NumSurvivors = FMath::Clamp((int)(m_GameMode->GetParameters()->dSurvivalRate * m_Members.Num()) + 2, 1, m_Members.Num());
+
+	m_ParentWeights.SetNumUninitialized(NumSurvivors, false);
+	for (int i = 0; i < NumSurvivors; ++i)
+	{
+		switch (m_GameMode->GetParameters()->iParentSelection)
+		{
+		case fitness_proportional:
+			m_ParentWeights[i] = m_Members[i]->GetFitness();
+			break;
+		case rank_based:
+			m_ParentWeights[i] = NumSurvivors - i;
+			break;
+		default:
+			m_ParentWeights[i] = 1.0;
+			break;
+		}
+	}
+
+	m_ParentTable.Build(m_ParentWeights);
 }
 
 void USpecies::Purge()
 {
 	m_Members.Empty();
+	m_ParentTable.Reset();
 	++m_iSpeciesAge;
 	++m_iGensNoImprovement;
 	m_dSpawnAmount = 0;
@@ -90,25 +127,32 @@ void USpecies::CalculateSpawnAmount()
 	}
 }
 
-UGenome* USpecies::GetTopGenome()
+UGenome* USpecies::GetTopGenome(FRandomStream &rng)
 {
-	UGenome* Genome;
-
-	if (m_Members.Num() == 1)
-	{
-		Genome = m_Members[0];
-	}
-	else
+	if (m_Members.Num() == 1 || m_ParentTable.Num() == 0)
 	{
-		int Max = (int)(m_GameMode->GetParameters()->dSurvivalRate * m_Members.Num()) + 1;
-		int ChosenOne = RandInt(0, Max);
-		Genome = m_Members[ChosenOne];
+		return m_Members[0];
 	}
 
-	return Genome;
+	return m_Members[m_ParentTable.Sample(rng)];
 }
 
 double USpecies::GetLeaderFitness()
 {
 	return m_Leader->GetFitness();
 }
+
+double USpecies::GetAverageFitness()
+{
+	if (m_Members.Num() == 0)
+	{
+		return 0.0;
+	}
+
+	double Total = 0.0;
+	for (UGenome* curGenome : m_Members)
+	{
+		Total += curGenome->GetFitness();
+	}
+	return Total / m_Members.Num();
+}
@@ -16,6 +16,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Info.h"
+#include "AliasTable.h"
 #include "Species.generated.h"
 
 
@@ -56,6 +57,10 @@ protected:
 		//how many of this species should be spawned for the next population
 		double m_dSpawnAmount;
 
+	//odds of the surviving members to become a parent, rebuilt by FinalizeMembers
+	FAliasTable m_ParentTable;
+	TArray<double> m_ParentWeights;
+
 public:
 	USpecies();
 	void Initialize(UGenome *firstGenome, int speciesID, AMyGameMode* gameMode);
@@ -63,17 +68,27 @@ public:
 	//Boost fitness of new species, penalizes old species and performs fitness sharing over the entire species
 	void AdjustFitnessScores();
 
-	//Add a new genome to the species
+	//Add a new genome to the species. The members are unordered until FinalizeMembers
 	void AddMember(UGenome *newGenome);
 
+	//Sorts the members by fitness and prepares parent selection. Call once after all members were added
+	void FinalizeMembers();
+
+	//Removes a member in steady state mode. The leader stays, it is the best genome the species ever had
+	void RemoveMember(UGenome *genome);
+
+	//Makes the genome the leader if it beats the best fitness of the species
+	void UpdateLeader(UGenome *genome);
+
 	//Clears out all member from last generation
 	void Purge();
 
 	//Calculates how many offsprings this species is allowed to produce
 	void CalculateSpawnAmount();
 
-	//Returns one of the top genomes of the species selected at random
-	UGenome* GetTopGenome();
+	//Returns one of the top genomes of the species drawn with the configured parent selection. Only reads the species,
+	//so it can be called from workers
+	UGenome* GetTopGenome(FRandomStream &rng);
 
 	//So we can sort species by best fitness. Largest first
 	friend bool operator<(const USpecies &lhs, const USpecies &rhs)
@@ -89,6 +104,7 @@ public:
 	int GetGensNoImprovement() { return m_iGensNoImprovement; }
 	int GetSpeciesID() { return m_iSpeciesID; }
 	double GetLeaderFitness();
+	double GetAverageFitness();
 	double GetBestFitness() { return m_dBestFitness; }
 	int GetAge() { return m_iSpeciesAge; }
 };
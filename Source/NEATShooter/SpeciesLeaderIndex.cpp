@@ -0,0 +1,123 @@
+//Copyright 2018 Raphael Haucke
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+//http ://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+
+#include "SpeciesLeaderIndex.h"
+#include "Async/ParallelFor.h"
+
+
+
+FSpeciesLeaderIndex::FSpeciesLeaderIndex()
+{
+	m_iNumLeaders = 0;
+	m_dCheapestUnmatched = 0;
+	m_bEnabled = false;
+	m_iNumRuledOut = 0;
+	m_iNumQueries = 0;
+}
+
+void FSpeciesLeaderIndex::Build(const TArray<const FSPackedLinks*> &leaders, const TArray<const FSLinkSignature*> &leaderSignatures, const FSCompatibilityCoefficients &coefficients)
+{
+	m_iNumLeaders = leaders.Num();
+	m_dCheapestUnmatched = FMath::Min(coefficients.dExcess, coefficients.dDisjoint);
+	m_bEnabled = (coefficients.dExcess >= 0) && (coefficients.dDisjoint >= 0) && (coefficients.dMatching >= 0) && (m_dCheapestUnmatched > 0);
+
+	m_LeaderGenes.SetNumUninitialized(m_iNumLeaders);
+	for (int i = 0; i < m_iNumLeaders; ++i)
+	{
+		m_LeaderGenes[i] = leaders[i]->InnovationIDs.Num();
+	}
+
+	m_LeaderUnmatched.SetNumUninitialized(m_iNumLeaders * m_iNumLeaders);
+
+	ParallelFor(m_iNumLeaders, [&](int32 First)
+	{
+		m_LeaderUnmatched[First * m_iNumLeaders + First] = 0;
+
+		for (int Second = First + 1; Second < m_iNumLeaders; ++Second)
+		{
+			const FSLinkSignature* Signature1 = leaderSignatures.IsValidIndex(First) ? leaderSignatures[First] : nullptr;
+			const FSLinkSignature* Signature2 = leaderSignatures.IsValidIndex(Second) ? leaderSignatures[Second] : nullptr;
+			int NumUnmatched;
+
+			if (Signature1 && Signature2 && Signature1->bValid && Signature2->bValid)
+			{
+				int NumExcess, NumDisjoint;
+				FCompatibility::CountUnmatched(*Signature1, *Signature2, NumExcess, NumDisjoint);
+				NumUnmatched = NumExcess + NumDisjoint;
+			}
+			else
+			{
+				NumUnmatched = FCompatibility::CountUnmatched(*leaders[First], *leaders[Second]);
+			}
+
+			//each task writes its row right of the diagonal and its column below it, so no two tasks share an entry
+			m_LeaderUnmatched[First * m_iNumLeaders + Second] = NumUnmatched;
+			m_LeaderUnmatched[Second * m_iNumLeaders + First] = NumUnmatched;
+		}
+	});
+}
+
+bool FSpeciesLeaderIndex::RulesOut(int numGenes, int leader, const FMeasuredLeaders &measured, double threshold) const
+{
+	if (!m_bEnabled)
+	{
+		return false;
+	}
+
+	const int LeaderGenes = m_LeaderGenes[leader];
+	const int NumGenesOfBigGenome = FMath::Max(numGenes, LeaderGenes);
+	if (NumGenesOfBigGenome == 0)
+	{
+		return false;
+	}
+
+	int MinUnmatched = FMath::Abs(numGenes - LeaderGenes);
+
+	const int* UnmatchedToLeader = &m_LeaderUnmatched[leader * m_iNumLeaders];
+	for (const FSMeasuredLeader &Pivot : measured)
+	{
+		MinUnmatched = FMath::Max(MinUnmatched, FMath::Abs(Pivot.NumUnmatched - UnmatchedToLeader[Pivot.Leader]));
+	}
+
+	double LowerBound = m_dCheapestUnmatched * MinUnmatched / NumGenesOfBigGenome;
+	return LowerBound > threshold + FSCompatibilityResult::BoundSlack;
+}
+
+bool FSpeciesLeaderIndex::RulesOutByGeneCount(int numGenes1, int numGenes2, double threshold) const
+{
+	const int NumGenesOfBigGenome = FMath::Max(numGenes1, numGenes2);
+	if (!m_bEnabled || (NumGenesOfBigGenome == 0))
+	{
+		return false;
+	}
+
+	double LowerBound = m_dCheapestUnmatched * FMath::Abs(numGenes1 - numGenes2) / NumGenesOfBigGenome;
+	return LowerBound > threshold + FSCompatibilityResult::BoundSlack;
+}
+
+void FSpeciesLeaderIndex::RecordQueries(int numQueries, int numRuledOut)
+{
+	m_iNumQueries += numQueries;
+	m_iNumRuledOut += numRuledOut;
+}
+
+double FSpeciesLeaderIndex::ConsumeRuledOutRate()
+{
+	double Rate = (m_iNumQueries > 0) ? double(m_iNumRuledOut) / m_iNumQueries : 0.0;
+
+	m_iNumQueries = 0;
+	m_iNumRuledOut = 0;
+
+	return Rate;
+}
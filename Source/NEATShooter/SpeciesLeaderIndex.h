@@ -0,0 +1,74 @@
+//Copyright 2018 Raphael Haucke
+//
+//Licensed under the Apache License, Version 2.0 (the "License");
+//you may not use this file except in compliance with the License.
+//You may obtain a copy of the License at
+//
+//http ://www.apache.org/licenses/LICENSE-2.0
+//
+//Unless required by applicable law or agreed to in writing, software
+//distributed under the License is distributed on an "AS IS" BASIS,
+//WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//See the License for the specific language governing permissions and
+//limitations under the License.
+
+#pragma once
+
+#include "Compatibility.h"
+
+#include "CoreMinimal.h"
+
+
+//Distance from a genome to a leader it was already tested against, used as pivot for the triangle bound
+struct FSMeasuredLeader
+{
+	int Leader;
+	int NumUnmatched;
+
+	FSMeasuredLeader() : Leader(-1), NumUnmatched(0) {}
+	FSMeasuredLeader(int leader, int numUnmatched) : Leader(leader), NumUnmatched(numUnmatched) {}
+};
+
+typedef TArray<FSMeasuredLeader, TInlineAllocator<32>> FMeasuredLeaders;
+
+//Rules out species leaders a genome can't be compatible with, without looking at its genes.
+//The number of unmatched (excess + disjoint) genes H between two genomes is the size of the symmetric difference of their
+//innovation sets and therefore a metric. The score is at least min(dExcess, dDisjoint) * H / N with N the size of the
+//bigger genome, and H is bounded from below by the difference of the gene counts and by the triangle inequality
+//H(genome, leader) >= |H(genome, pivot) - H(pivot, leader)| for every leader already measured
+class NEATSHOOTER_API FSpeciesLeaderIndex
+{
+private:
+	int m_iNumLeaders;
+	TArray<int> m_LeaderGenes;
+	//H between every pair of leaders, row per leader
+	TArray<int> m_LeaderUnmatched;
+
+	//cost of one unmatched gene in the cheaper of the two terms
+	double m_dCheapestUnmatched;
+	//the bounds only hold if no term can lower the score
+	bool m_bEnabled;
+
+	//lookups the index answered and lookups in total since the rate was last consumed
+	int m_iNumRuledOut;
+	int m_iNumQueries;
+
+public:
+	FSpeciesLeaderIndex();
+
+	//Measures the leaders against each other. A signature may be null or invalid, the links are compared then
+	void Build(const TArray<const FSPackedLinks*> &leaders, const TArray<const FSLinkSignature*> &leaderSignatures, const FSCompatibilityCoefficients &coefficients);
+
+	//Returns true if the genome can't be within threshold of the leader
+	bool RulesOut(int numGenes, int leader, const FMeasuredLeaders &measured, double threshold) const;
+
+	//Gene count bound only, for genomes that aren't in the index
+	bool RulesOutByGeneCount(int numGenes1, int numGenes2, double threshold) const;
+
+	void RecordQueries(int numQueries, int numRuledOut);
+
+	//Returns the share of leaders ruled out since the last call
+	double ConsumeRuledOutRate();
+
+	int GetNumLeaders() const { return m_iNumLeaders; }
+};